@@ -0,0 +1,41 @@
+# Generates a C source and header with the contents of binary files as const arrays.
+#
+# Usage:
+#	cmake -DOUTPUT_SOURCE=<file.c> -DOUTPUT_HEADER=<file.h> -DNAMES=<name|...> -DFILES=<path|...> -P EmbedFiles.cmake
+#
+# For each name, the header declares:
+#	extern const unsigned char <name>[<name>_SIZE];
+
+string(REPLACE "|" ";" NAMES "${NAMES}")
+string(REPLACE "|" ";" FILES "${FILES}")
+
+list(LENGTH NAMES nNames)
+list(LENGTH FILES nFiles)
+if(NOT nNames EQUAL nFiles)
+	message(FATAL_ERROR "EmbedFiles: NAMES and FILES must have the same length")
+endif()
+
+get_filename_component(headerName "${OUTPUT_HEADER}" NAME)
+
+set(header "// generated by cmake/EmbedFiles.cmake, do not edit\n\n#pragma once\n")
+set(source "// generated by cmake/EmbedFiles.cmake, do not edit\n\n#include \"${headerName}\"\n")
+
+math(EXPR lastIndex "${nNames} - 1")
+foreach(i RANGE ${lastIndex})
+	list(GET NAMES ${i} name)
+	list(GET FILES ${i} path)
+
+	file(READ "${path}" hex HEX)
+	string(LENGTH "${hex}" hexLength)
+	math(EXPR size "${hexLength} / 2")
+
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+	# 16 bytes per line
+	string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n\t" bytes "${bytes}")
+
+	string(APPEND header "\n#define ${name}_SIZE ${size}\nextern const unsigned char ${name}[${name}_SIZE];\n")
+	string(APPEND source "\n// ${path}\nconst unsigned char ${name}[${name}_SIZE] = {\n\t${bytes}\n};\n")
+endforeach()
+
+file(WRITE "${OUTPUT_HEADER}" "${header}")
+file(WRITE "${OUTPUT_SOURCE}" "${source}")
@@ -0,0 +1,91 @@
+#include "Arena.h"
+#include "Constants.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct ArenaChunk {
+	ArenaChunk* next;
+	size_t size;
+	size_t used;
+	// pad header so data is aligned
+	_Alignas(ARENA_ALIGNMENT) unsigned char data[];
+};
+
+static size_t AlignUp(size_t size){
+	return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaChunk* ArenaChunk_New(size_t size){
+	ArenaChunk* chunk = malloc(sizeof(*chunk) + size);
+	if(chunk == NULL) return NULL;
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+void Arena_Init(Arena* arena, size_t chunkSize){
+	arena->chunks = NULL;
+	arena->chunkSize = AlignUp(chunkSize);
+	arena->used = 0;
+	arena->highWater = 0;
+	arena->nAllocs = 0;
+}
+
+void* Arena_Alloc(Arena* arena, size_t size){
+	size = AlignUp(size);
+
+	// the head chunk is the only one with free space
+	ArenaChunk* chunk = arena->chunks;
+	if(chunk == NULL || chunk->size - chunk->used < size){
+		chunk = ArenaChunk_New(KET_MAX(size, arena->chunkSize));
+		if(chunk == NULL) return NULL;
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	void* mem = chunk->data + chunk->used;
+	chunk->used += size;
+
+	arena->used += size;
+	arena->nAllocs += 1;
+	if(arena->used > arena->highWater) arena->highWater = arena->used;
+
+	return mem;
+}
+
+void Arena_Reset(Arena* arena){
+	// if we overflowed into several chunks, replace them with one chunk
+	// big enough to hold all of them so the next round fits in one
+	if(arena->chunks != NULL && arena->chunks->next != NULL){
+		size_t totalSize = 0;
+		ArenaChunk* chunk = arena->chunks;
+		while(chunk != NULL){
+			ArenaChunk* next = chunk->next;
+			totalSize += chunk->size;
+			free(chunk);
+			chunk = next;
+		}
+		arena->chunks = ArenaChunk_New(totalSize);
+	}
+
+	if(arena->chunks != NULL) arena->chunks->used = 0;
+
+	arena->used = 0;
+	arena->nAllocs = 0;
+}
+
+void Arena_Free(Arena* arena){
+	ArenaChunk* chunk = arena->chunks;
+	while(chunk != NULL){
+		ArenaChunk* next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	arena->chunks = NULL;
+	arena->used = 0;
+	arena->nAllocs = 0;
+}
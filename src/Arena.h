@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+// bump allocator: allocations are never freed individually,
+// everything is released at once with Arena_Reset
+typedef struct Arena {
+	ArenaChunk* chunks;
+	size_t chunkSize;
+
+	// bytes handed out since the last reset
+	size_t used;
+	// largest value used has reached since Arena_Init
+	size_t highWater;
+	// allocations since the last reset
+	size_t nAllocs;
+} Arena;
+
+void Arena_Init(Arena*, size_t chunkSize);
+
+// returned memory is aligned to ARENA_ALIGNMENT
+void* Arena_Alloc(Arena*, size_t size);
+
+// invalidates everything allocated so far, but keeps the memory around
+void Arena_Reset(Arena*);
+
+void Arena_Free(Arena*);
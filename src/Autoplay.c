@@ -0,0 +1,254 @@
+#include "Autoplay.h"
+#include "State.h"
+#include "Solver.h"
+#include "Repair.h"
+#include "Constants.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct AutoplayStats {
+	uint64_t nGames;
+	uint64_t nGamesWon;
+	uint64_t nMoves;
+	uint64_t nGuesses;
+	uint64_t bbbv;
+	uint64_t nGamesByTechnique[SOLVE_TECHNIQUE_COUNT];
+	// time spent solving and playing moves
+	uint64_t moveCounter;
+	// most a single SolveIter needed from its arena
+	size_t arenaHighWater;
+} AutoplayStats;
+
+typedef struct AutoplayWorker {
+	SDL_Thread* thread;
+	int id;
+
+	int width, height, nMines;
+	const DifficultyBand* band;
+	SDL_atomic_t* nGamesLeft;
+
+	AutoplayStats stats;
+	// a first click found no solvable board, every worker stops
+	bool failed;
+} AutoplayWorker;
+
+// the solver's view only ever holds what the player knows: the first click, deductions and guesses
+// nPlayed counts its changes already on the board
+
+// plays every move the solver could deduce
+// returns false if there weren't any
+static bool Autoplay_PlayDeductions(State* state, SolveState* solveState, int* nPlayed, AutoplayStats* stats){
+	if(!SolveIter(solveState, false) && !SolveIter(solveState, true)) return false;
+
+	bool played = false;
+	for(; *nPlayed < solveState->nChanges && !state->gameOver; ++*nPlayed){
+		int i = solveState->changes[*nPlayed];
+		TileState tileState = state->board.tiles[i].state;
+		int x = i % state->board.width, y = i / state->board.width;
+
+		if(SolveState_Flagged(solveState, i)){
+			if(tileState & TILE_STATE_FLAG) continue;
+			State_FlagTile(state, x, y);
+		}
+		// might have been uncovered by an earlier click's flood fill
+		else if(!(tileState & TILE_STATE_UNCOVERED)){
+			State_ClickTile(state, x, y);
+		}
+		else continue;
+
+		++stats->nMoves;
+		played = true;
+	}
+	return played;
+}
+
+static void Autoplay_Guess(State* state, SolveState* solveState, int* nPlayed, float* risk, Random* random, AutoplayStats* stats){
+	EstimateMineRisk(solveState, risk);
+
+	// pick uniformly among the safest tiles
+	float lowestRisk = SOLVER_NO_RISK;
+	int nLowest = 0;
+	int choice = -1;
+	for(int i = 0; i < state->board.width * state->board.height; ++i){
+		if(risk[i] < lowestRisk){
+			lowestRisk = risk[i];
+			nLowest = 1;
+			choice = i;
+		}
+		else if(risk[i] == lowestRisk && risk[i] != SOLVER_NO_RISK && Random_Below(random, ++nLowest) == 0){
+			choice = i;
+		}
+	}
+
+	if(choice == -1){
+		// every covered tile is flagged yet the game isn't won, give up
+		state->gameOver = true;
+		return;
+	}
+
+	State_ClickTile(state, choice % state->board.width, choice / state->board.width);
+	++stats->nMoves;
+	++stats->nGuesses;
+
+	if(!state->gameOver){
+		ClearTile(solveState, choice % state->board.width, choice / state->board.width);
+		*nPlayed = solveState->nChanges;
+	}
+}
+
+// returns false if the first click couldn't generate a board
+static bool Autoplay_PlayGame(State* state, SolveState* solveState, float* risk, Random* random, AutoplayStats* stats){
+	State_ResetBoard(state);
+
+	uint64_t start = SDL_GetPerformanceCounter();
+
+	// the generator keeps the first click's surroundings clear, so it's never a guess
+	int x = Random_Below(random, state->board.width);
+	int y = Random_Below(random, state->board.height);
+	State_ClickTile(state, x, y);
+	if(!state->gameStarted) return false;
+	++stats->nMoves;
+
+	// the board only exists once the first click created it
+	SolveState_Reset(solveState, state);
+	ClearTile(solveState, x, y);
+	int nPlayed = solveState->nChanges;
+
+	while(!state->gameOver){
+		if(!Autoplay_PlayDeductions(state, solveState, &nPlayed, stats)){
+			Autoplay_Guess(state, solveState, &nPlayed, risk, random, stats);
+		}
+	}
+
+	stats->moveCounter += SDL_GetPerformanceCounter() - start;
+	++stats->nGames;
+	stats->bbbv += state->board.score.bbbv;
+	++stats->nGamesByTechnique[state->board.score.technique];
+	if(state->gameWon) ++stats->nGamesWon;
+	return true;
+}
+
+static int AutoplayThread(void* data){
+	AutoplayWorker* worker = data;
+
+	State state;
+	State_InitHeadless(&state);
+	state.board.width = worker->width;
+	state.board.height = worker->height;
+	state.board.nMines = worker->nMines;
+	if(worker->band != NULL){
+		state.game.band = *worker->band;
+		// games are already spread over threads
+		state.game.band.nThreads = 1;
+	}
+
+	size_t nTiles = (size_t) worker->width * worker->height;
+	float* risk = malloc(nTiles * sizeof(*risk));
+
+	SolveState solveState = { 0 };
+
+	Random random;
+	Random_Seed(&random, SDL_GetPerformanceCounter() + worker->id);
+
+	while(SDL_AtomicAdd(worker->nGamesLeft, -1) > 0){
+		if(!Autoplay_PlayGame(&state, &solveState, risk, &random, &worker->stats)){
+			worker->failed = true;
+			SDL_AtomicSet(worker->nGamesLeft, 0);
+		}
+	}
+
+	worker->stats.arenaHighWater = solveState.arena.highWater;
+	SolveState_Free(&solveState);
+	free(risk);
+	State_Destroy(&state);
+	return 0;
+}
+
+bool Autoplay_Run(int nGames, int nThreads, int width, int height, int nMines, const DifficultyBand* band){
+	if(!Repair_CanGenerate(width, height, nMines)){
+		fprintf(stderr, "Invalid board %dx%d with %d mines\n", width, height, nMines);
+		return false;
+	}
+
+	SDL_atomic_t nGamesLeft;
+	SDL_AtomicSet(&nGamesLeft, nGames);
+
+	AutoplayWorker* workers = calloc(nThreads, sizeof(*workers));
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < nThreads; ++i){
+		workers[i] = (AutoplayWorker) {
+			.id = i,
+			.width = width,
+			.height = height,
+			.nMines = nMines,
+			.band = band,
+			.nGamesLeft = &nGamesLeft,
+		};
+		workers[i].thread = SDL_CreateThread(AutoplayThread, "Autoplay", &workers[i]);
+	}
+
+	AutoplayStats total = { 0 };
+	bool failed = false;
+	for(int i = 0; i < nThreads; ++i){
+		SDL_WaitThread(workers[i].thread, NULL);
+		failed |= workers[i].failed;
+
+		total.nGames += workers[i].stats.nGames;
+		total.nGamesWon += workers[i].stats.nGamesWon;
+		total.nMoves += workers[i].stats.nMoves;
+		total.nGuesses += workers[i].stats.nGuesses;
+		total.bbbv += workers[i].stats.bbbv;
+		for(int j = 0; j < SOLVE_TECHNIQUE_COUNT; ++j){
+			total.nGamesByTechnique[j] += workers[i].stats.nGamesByTechnique[j];
+		}
+		total.moveCounter += workers[i].stats.moveCounter;
+		total.arenaHighWater = KET_MAX(total.arenaHighWater, workers[i].stats.arenaHighWater);
+	}
+	double frequency = (double) SDL_GetPerformanceFrequency();
+	double seconds = (SDL_GetPerformanceCounter() - start) / frequency;
+
+	free(workers);
+
+	if(failed){
+		fprintf(stderr, "Could not generate a solvable %dx%d board with %d mines after %d tries\n", width, height, nMines, GENERATOR_MAX_BOARDS);
+		return false;
+	}
+
+	printf(
+		"Autoplayed %llu games of %dx%d with %d mines on %d threads in %.2f s\n",
+		(unsigned long long) total.nGames,
+		width, height, nMines,
+		nThreads,
+		seconds
+	);
+	printf(
+		"\t%.0f games/s, %.1f 3BV per game\n",
+		total.nGames / seconds,
+		total.nGames ? (double) total.bbbv / total.nGames : 0.0
+	);
+	printf(
+		"\t%.2f%% won, %.3f guesses per game\n",
+		total.nGames ? total.nGamesWon * 100.0 / total.nGames : 0.0,
+		total.nGames ? (double) total.nGuesses / total.nGames : 0.0
+	);
+	printf(
+		"\t%.3f us per move, %.1f moves per game\n",
+		total.nMoves ? total.moveCounter * 1000000.0 / frequency / total.nMoves : 0.0,
+		total.nGames ? (double) total.nMoves / total.nGames : 0.0
+	);
+	printf("\tsolver temporaries peaked at %zu bytes per iteration\n", total.arenaHighWater);
+
+	printf("\tHardest technique needed:");
+	for(int i = 0; i < SOLVE_TECHNIQUE_COUNT; ++i){
+		printf(
+			" %s %.1f%%",
+			SOLVE_TECHNIQUE_NAMES[i],
+			total.nGames ? total.nGamesByTechnique[i] * 100.0 / total.nGames : 0.0
+		);
+	}
+	printf("\n");
+
+	return true;
+}
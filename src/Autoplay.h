@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "Difficulty.h"
+
+// plays nGames full games headless across nThreads threads, making every move the solver
+// can deduce and the lowest-risk guess otherwise, then prints games/s, win rate and time per move
+// boards are generated inside band, which may be NULL
+// returns false if the board is invalid or a game's first click couldn't generate a solvable one
+bool Autoplay_Run(int nGames, int nThreads, int width, int height, int nMines, const DifficultyBand* band);
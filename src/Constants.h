@@ -19,65 +19,111 @@
 
 #define BOARD_CLICK_SAFE_AREA 3
 
-#define SOLVER_MAX_UNSOLVABLE_TILES_FOR_PERTURBATION 5
-#define SOLVER_MAX_PERTURBATIONS 2
-#define SOLVER_MAX_PERTURBATION_DISTANCE 5
-#define SOLVER_MIN_PERTURBATION_DISTANCE 3
+// mines moved out of the way before a board is thrown away and generated again
+#define GENERATOR_MAX_REPAIRS 64
+// times construction may get stuck before falling back to generating and repairing
+#define GENERATOR_MAX_MOVES 256
+// boards generated and repaired before giving up, a board too dense to ever be solvable would spin forever
+#define GENERATOR_MAX_BOARDS 1000
+// candidate boards sampled before giving up on a difficulty band
+#define DIFFICULTY_BAND_MAX_CANDIDATES 4096
+
+// largest number of covered tiles the pattern table knows about for one number
+// bigger neighborhoods leave their deductions to RREF
+#define PATTERN_MAX_TILES 8
+
+// slots in a solver cache, a power of 2, and how many ints its signatures may take in total
+#define SOLVER_CACHE_CAPACITY 4096
+#define SOLVER_CACHE_MAX_INTS (1 << 18)
+
+// risk given to tiles that can't be clicked, higher than any probability
+#define SOLVER_NO_RISK 2.0f
+
+// tiles only have sprites for numbers up to 8
+#define NEIGHBORHOOD_MAX_COUNT 8
+#define NEIGHBORHOOD_MAX_OFFSETS NEIGHBORHOOD_MAX_COUNT
+#define NEIGHBORHOOD_MAX_REACH 3
+
+#define ARENA_ALIGNMENT 16
+
+#define TIMELINE_MAX_MARKS 32
+
+// spans kept per thread, a power of 2 so the ring index survives its counter wrapping
+#define TRACE_RING_SIZE 8192
+// spans nested deeper are counted but not recorded
+#define TRACE_MAX_DEPTH 32
+#define TRACE_MAX_ARGS 6
+
+// frame times the perf HUD keeps, 4 s at 60 fps
+#define PERF_HUD_N_FRAMES 240
+// frame time histogram, 1 ms per bucket, the last one takes every slower frame
+#define PERF_HUD_N_BUCKETS 34
+// HUD digits relative to the counters' digits
+#define PERF_HUD_DIGIT_SCALE 0.5f
+
+// see Histogram.h, 16 buckets per power of 2
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_N_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) << HISTOGRAM_SUB_BUCKET_BITS)
+
+// inputs handled in one frame whose latency is measured, later ones in the same frame aren't
+#define LATENCY_MAX_PENDING 64
+
+// boards and game modes metrics are kept for, values for any others are dropped
+#define METRICS_MAX_BOARDS 16
+#define METRICS_WRITE_INTERVAL_MS 10000
+
+// the main loop not coming around for this long is logged as a stall, see Watchdog.h
+#define WATCHDOG_STALL_MS 100
+// how often the watchdog checks, stalls are logged up to this late
+#define WATCHDOG_POLL_MS 10
+
+// requests a server shard holds before clients sending to it have to wait, see Server.h
+#define SERVER_QUEUE_SIZE 1024
+// responses a client may leave unread before it's dropped
+#define SERVER_MAX_OUTPUT (16 * 1024 * 1024)
+// requests read off one connection before the server moves on to the next one
+#define SERVER_READ_REQUESTS 64
+// largest board a server session may have, 1 byte each
+#define SERVER_MAX_TILES (1 << 20)
+
+// "KETR": recorded input, see Replay.h
+#define REPLAY_MAGIC 0x5254454B
+#define REPLAY_VERSION 6
+// slowest events reported at the end of a replay
+#define REPLAY_N_SLOWEST 5
+
+// "KETS": saved game, see Snapshot.h
+#define SNAPSHOT_MAGIC 0x5354454B
+#define SNAPSHOT_VERSION 1
+
+// default size of a thumbnail, see Thumbnail.h
+#define THUMBNAIL_WIDTH 350
+#define THUMBNAIL_HEIGHT 250
+
+// undo history takes a checkpoint every time its moves have changed this fraction of the board's tiles
+#define HISTORY_CHECKPOINT_FRACTION 8
+
+// how long a custom theme must go without changes before it's reloaded
+#define THEME_WATCHER_SETTLE_MS 100
+
+// lua allocations made during create_game come from an arena
+// blocks are rounded up to a power of 2 size class: 16, 32, ..., 1024
+// anything bigger, or past the reserved address space, goes to malloc
+#define LUA_ARENA_RESERVE_SIZE (64 * 1024 * 1024)
+// committed this much at a time
+#define LUA_ARENA_CHUNK_SIZE (256 * 1024)
+#define LUA_ARENA_MIN_BLOCK_SIZE 16
+#define LUA_ARENA_N_SIZE_CLASSES 7
+// gc pause (in %) while create_game runs: only collect once the heap has quadrupled
+#define LUA_ARENA_GC_PAUSE 400
+#define LUA_DEFAULT_GC_STEPMUL 100
+
+// first chunk of a solver's scratch arena, it grows to the largest iteration seen
+#define SOLVER_ARENA_CHUNK_SIZE (64 * 1024)
 
-#define RC_TYPE_IMAGE L"KET_IMAGE"
-#define RC_TYPE_RECT L"KET_RECT"
 #define RC_TYPE_COLOR L"KET_COLOR"
 
-#define RC_TILESHEET_DEFAULT L"TILESHEET_ORIGINAL"
-#define RC_TILESHEET_CUTE L"TILESHEET_CUTE"
-
-#define RC_TILE_NORMAL L"TILE_NORMAL"
-#define RC_TILE_PRESSED L"TILE_PRESSED"
-#define RC_TILE_FLAGGED L"TILE_FLAGGED"
-#define RC_TILE_BOMB L"TILE_BOMB"
-#define RC_TILE_BOMB_RED L"TILE_BOMB_RED"
-#define RC_TILE_BOMB_RED L"TILE_BOMB_RED"
-
-#define RC_TILE_1 L"TILE_1"
-#define RC_TILE_2 L"TILE_2"
-#define RC_TILE_3 L"TILE_3"
-#define RC_TILE_4 L"TILE_4"
-#define RC_TILE_5 L"TILE_5"
-#define RC_TILE_6 L"TILE_6"
-#define RC_TILE_7 L"TILE_7"
-#define RC_TILE_8 L"TILE_8"
-
-#define RC_SMILEY_DEFAULT L"SMILEY_DEFAULT"
-#define RC_SMILEY_PRESSED L"SMILEY_PRESSED"
-#define RC_SMILEY_WIN L"SMILEY_WIN"
-#define RC_SMILEY_LOSE L"SMILEY_LOSE"
-#define RC_SMILEY_SURPRISE L"SMILEY_SURPRISE"
-
-#define RC_DIGIT_0 L"DIGIT_0"
-#define RC_DIGIT_1 L"DIGIT_1"
-#define RC_DIGIT_2 L"DIGIT_2"
-#define RC_DIGIT_3 L"DIGIT_3"
-#define RC_DIGIT_4 L"DIGIT_4"
-#define RC_DIGIT_5 L"DIGIT_5"
-#define RC_DIGIT_6 L"DIGIT_6"
-#define RC_DIGIT_7 L"DIGIT_7"
-#define RC_DIGIT_8 L"DIGIT_8"
-#define RC_DIGIT_9 L"DIGIT_9"
-#define RC_DIGIT_MINUS L"DIGIT_MINUS"
-
-#define RC_BORDER_DR L"BORDER_DR"
-#define RC_BORDER_DL L"BORDER_DL"
-#define RC_BORDER_UR L"BORDER_UR"
-#define RC_BORDER_UL L"BORDER_UL"
-
-#define RC_BORDER_LR L"BORDER_LR"
-#define RC_BORDER_UD L"BORDER_UD"
-
-#define RC_BORDER_ULD L"BORDER_ULD"
-#define RC_BORDER_URD L"BORDER_URD"
-
 #define RC_BACKGROUND_COLOR L"BG_COLOR"
-#define RC_BACKGROUND_RECT L"BACKGROUND"
 
 #define RC_CUSTOM_DIFFICULTY_DIALOG L"KET_CUSTOM_DIFFICULTY"
 
@@ -87,6 +133,8 @@
 #define MENU_DEFAULT_CUSTOM_GAMEMODE_TEXT L"Custom"
 
 #define IDM_EXIT 200
+#define IDM_SAVE 201
+#define IDM_OPEN 202
 
 #define IDM_EASY 210
 #define IDM_MEDIUM 211
@@ -0,0 +1,154 @@
+#include "Construct.h"
+#include "Repair.h"
+#include "State.h"
+#include "Solver.h"
+#include "Constants.h"
+#include "Trace.h"
+
+#include <stdlib.h>
+
+typedef struct Construction {
+	State* state;
+	// whether a tile is known to be a mine or not yet
+	// every tile an uncovered number counts is decided
+	bool* decided;
+	int nUndecided;
+	// mines not on a decided tile yet
+	int nMinesLeft;
+} Construction;
+
+// same odds State_GenerateMinesDefault gives each tile, so exactly nMines end up placed
+static void Construction_Decide(Construction* construction, int index){
+	if(construction->decided[index]) return;
+	construction->decided[index] = true;
+
+	float probability = (float) construction->nMinesLeft / construction->nUndecided--;
+	if(Random_Float(&construction->state->game.random) < probability){
+		construction->state->board.tiles[index].state |= TILE_STATE_MINE;
+		--construction->nMinesLeft;
+	}
+}
+
+// decides everything the tile counts right before the solver reads its number
+static void Construction_OnUncover(SolveState* solveState, int index, void* data){
+	Construction* construction = data;
+	const Neighborhood* nh = solveState->neighborhood;
+	int w = solveState->w, h = solveState->h;
+	Tile* tiles = construction->state->board.tiles;
+
+	// only ever uncovered when proven safe, which the odds respect
+	Construction_Decide(construction, index);
+
+	int count = 0;
+	for(int i = 0; i < nh->n; ++i){
+		int x, y;
+		if(!Neighborhood_Neighbor(nh, w, h, index % w, index / w, i, &x, &y)) continue;
+
+		Construction_Decide(construction, x + y * w);
+		if(tiles[x + y * w].state & TILE_STATE_MINE) count += nh->weight[i];
+	}
+	tiles[index].surroundingMines = count;
+}
+
+// tileX is -1 to resume without clicking
+static bool Construction_Solve(SolveState* solveState, int tileX, int tileY){
+	SolveParams solveParams = {
+		.state = solveState,
+		.tileClicked = { tileX, tileY },
+		// every iteration uncovers or flags something, so it always stops
+		.maxIters = 0,
+	};
+
+	TilePosition* unsolvableTiles;
+	size_t nUnsolvableTiles;
+	bool solved = HasSolution(&solveParams, &unsolvableTiles, &nUnsolvableTiles);
+	return solved;
+}
+
+bool State_ConstructBoard(State* state, int tileX, int tileY, int maxMoves, SolveTechnique* hardest){
+	TRACE_BEGIN("State_ConstructBoard");
+
+	int w = state->board.width, h = state->board.height;
+	Tile* tiles = state->board.tiles;
+
+	Construction construction = {
+		.state = state,
+		.decided = calloc(w * h, sizeof(bool)),
+		.nUndecided = w * h,
+		.nMinesLeft = state->board.nMines,
+	};
+	// same area State_GenerateMinesDefault keeps clear
+	for(int y = KET_MAX(tileY - BOARD_CLICK_SAFE_AREA + 1, 0); y < KET_MIN(tileY + BOARD_CLICK_SAFE_AREA, h); ++y){
+		for(int x = KET_MAX(tileX - BOARD_CLICK_SAFE_AREA + 1, 0); x < KET_MIN(tileX + BOARD_CLICK_SAFE_AREA, w); ++x){
+			construction.decided[x + y * w] = true;
+			--construction.nUndecided;
+		}
+	}
+
+	SolveState* solveState = state->game.solveState;
+	SolveState_Reset(solveState, state);
+	solveState->onUncover = Construction_OnUncover;
+	solveState->onUncoverData = &construction;
+
+	bool solved = Construction_Solve(solveState, tileX, tileY);
+
+	bool* vacated = calloc(w * h, sizeof(bool));
+	bool* targets = malloc(w * h * sizeof(bool));
+
+	int move = 0;
+	for(; !solved && move < maxMoves; ++move){
+		// undecided tiles aren't counted by anything, so moves mostly hand the mine back to them,
+		// unless every undecided tile already has to be a mine
+		// mines never go back where one was moved off, or two tiles could trade one forever
+		bool full = construction.nMinesLeft >= construction.nUndecided;
+		for(int i = 0; i < w * h; ++i){
+			targets[i] = !vacated[i] && (construction.decided[i] || !full);
+		}
+
+		int from, to;
+		int firstChanged = Repair_ChooseMove(state, solveState, tileX, tileY, targets, &from, &to);
+		if(firstChanged == -1) break;
+
+		tiles[from].state &= ~TILE_STATE_MINE;
+		vacated[from] = true;
+		if(construction.decided[to]){
+			tiles[to].state |= TILE_STATE_MINE;
+		}
+		else{
+			// placed whenever the solver reaches it, maybe somewhere else
+			++construction.nMinesLeft;
+		}
+
+		// numbers uncovered again are counted again by Construction_OnUncover
+		RollbackSolveState(solveState, firstChanged - 1);
+		if(firstChanged == 0){
+			solved = Construction_Solve(solveState, tileX, tileY);
+		}
+		else{
+			solved = Construction_Solve(solveState, -1, -1);
+		}
+	}
+
+	if(solved){
+		// whatever the solver never uncovered, ie: flagged tiles
+		for(int i = 0; i < w * h; ++i){
+			Construction_Decide(&construction, i);
+		}
+		State_GenerateFlagsDefault(state);
+	}
+	else{
+		State_ClearBoard(state);
+	}
+
+	if(hardest != NULL) *hardest = solveState->hardest;
+	state->board.nGeneratorMoves += move;
+
+	free(targets);
+	free(vacated);
+	free(construction.decided);
+
+	TRACE_ARG("moves", move);
+	TRACE_ARG("solved", solved);
+	TRACE_END();
+	return solved;
+}
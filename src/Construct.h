@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "Difficulty.h"
+
+struct State;
+
+// builds a default board while solving it from the first click
+// a tile's surroundings only get mines once the solver uncovers it,
+// so whenever the solver is stuck the mine it can't place is moved into the part of the board nothing counts yet
+// the solver finishes the board by construction, at most maxMoves times it gets stuck
+// returns false if it ran out of moves, the board is cleared then
+// hardest may be NULL, it can overestimate like State_RepairBoard's
+bool State_ConstructBoard(struct State*, int tileX, int tileY, int maxMoves, SolveTechnique* hardest);
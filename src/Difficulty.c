@@ -0,0 +1,169 @@
+#include "Difficulty.h"
+
+#include "State.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char* SOLVE_TECHNIQUE_NAMES[SOLVE_TECHNIQUE_COUNT] = {
+	"none",
+	"single",
+	"pattern",
+	"rref",
+	"global",
+};
+
+bool SolveTechnique_Parse(const char* name, SolveTechnique* technique){
+	for(int i = 0; i < SOLVE_TECHNIQUE_COUNT; ++i){
+		if(strcmp(name, SOLVE_TECHNIQUE_NAMES[i]) == 0){
+			*technique = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DifficultyBand_Init(DifficultyBand* band){
+	*band = (DifficultyBand) {
+		.enabled = false,
+		.minBBBV = 0,
+		.maxBBBV = INT_MAX,
+		.minTechnique = SOLVE_TECHNIQUE_NONE,
+		.maxTechnique = SOLVE_TECHNIQUE_COUNT - 1,
+		.nThreads = 0,
+	};
+}
+
+bool DifficultyBand_Contains(const DifficultyBand* band, const BoardScore* score){
+	return score->bbbv >= band->minBBBV && score->bbbv <= band->maxBBBV
+		&& score->technique >= band->minTechnique && score->technique <= band->maxTechnique;
+}
+
+// tiles that take no part in labeling: mines and numbers an opening uncovers
+#define NOT_LABELED -1
+
+static int Find(int* parent, int i){
+	while(parent[i] != i){
+		// path halving
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+// returns true if a and b were in different sets
+static bool Union(int* parent, int a, int b){
+	a = Find(parent, a);
+	b = Find(parent, b);
+	if(a == b) return false;
+
+	// smaller index as the root keeps trees shallow in raster order
+	if(a < b) parent[b] = a;
+	else parent[a] = b;
+	return true;
+}
+
+static bool IsOpening(const Tile* tile){
+	return !(tile->state & TILE_STATE_MINE) && tile->surroundingMines == 0;
+}
+
+void Difficulty_Score(const Neighborhood* nh, const Tile* tiles, int w, int h, BoardScore* score){
+	int* parent = malloc((size_t) w * h * sizeof(*parent));
+
+	int linearOffsets[NEIGHBORHOOD_MAX_OFFSETS];
+	for(int i = 0; i < nh->n; ++i){
+		linearOffsets[i] = nh->dx[i] + nh->dy[i] * w;
+	}
+
+	// edges go both ways: to the tiles a tile counts, and to the tiles that count it
+	// every edge is joined when its later tile is visited, so in the interior
+	// only the distinct offsets pointing back are needed (4 for moore, not 16)
+	int nBackOffsets = 0;
+	int backOffsets[NEIGHBORHOOD_MAX_OFFSETS * 2];
+	for(int i = 0; i < nh->n * 2; ++i){
+		int offset = i < nh->n ? linearOffsets[i] : -linearOffsets[i - nh->n];
+		if(offset >= 0) continue;
+
+		bool duplicate = false;
+		for(int j = 0; j < nBackOffsets; ++j){
+			duplicate = duplicate || backOffsets[j] == offset;
+		}
+		if(!duplicate) backOffsets[nBackOffsets++] = offset;
+	}
+
+	int nOpeningTiles = 0, nOpeningMerges = 0;
+	int nIslandTiles = 0, nIslandMerges = 0;
+
+	for(int y = 0; y < h; ++y){
+		bool interiorRow = y >= nh->reachY && y < h - nh->reachY;
+
+		for(int x = 0; x < w; ++x){
+			int index = x + y * w;
+			const Tile* tile = &tiles[index];
+			bool interior = interiorRow && x >= nh->reachX && x < w - nh->reachX;
+
+			parent[index] = NOT_LABELED;
+			if(tile->state & TILE_STATE_MINE) continue;
+
+			bool opening = tile->surroundingMines == 0;
+			if(!opening){
+				// a number next to an opening is uncovered for free
+				bool reached = false;
+				for(int i = 0; i < nh->n && !reached; ++i){
+					if(interior){
+						reached = IsOpening(&tile[-linearOffsets[i]]);
+					}
+					else {
+						int nx, ny;
+						reached = Neighborhood_Referrer(nh, w, h, x, y, i, &nx, &ny) && IsOpening(&tiles[nx + ny * w]);
+					}
+				}
+				if(reached) continue;
+			}
+
+			parent[index] = index;
+			if(opening) ++nOpeningTiles;
+			else ++nIslandTiles;
+
+			if(interior){
+				for(int i = 0; i < nBackOffsets; ++i){
+					int other = index + backOffsets[i];
+					if(parent[other] == NOT_LABELED || (tiles[other].surroundingMines == 0) != opening) continue;
+
+					if(Union(parent, index, other)){
+						if(opening) ++nOpeningMerges;
+						else ++nIslandMerges;
+					}
+				}
+				continue;
+			}
+
+			for(int i = 0; i < nh->n; ++i){
+				for(int direction = -1; direction <= 1; direction += 2){
+					int nx, ny;
+					bool onBoard = direction > 0
+						? Neighborhood_Neighbor(nh, w, h, x, y, i, &nx, &ny)
+						: Neighborhood_Referrer(nh, w, h, x, y, i, &nx, &ny);
+					if(!onBoard) continue;
+
+					int other = nx + ny * w;
+
+					if(other >= index || parent[other] == NOT_LABELED) continue;
+					if((tiles[other].surroundingMines == 0) != opening) continue;
+
+					if(Union(parent, index, other)){
+						if(opening) ++nOpeningMerges;
+						else ++nIslandMerges;
+					}
+				}
+			}
+		}
+	}
+
+	free(parent);
+
+	score->nOpenings = nOpeningTiles - nOpeningMerges;
+	score->nIslands = nIslandTiles - nIslandMerges;
+	score->bbbv = score->nOpenings + nIslandTiles;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Neighborhood.h"
+
+struct Tile;
+
+// hardest kind of deduction the solver needed, from easiest to hardest
+typedef enum SolveTechnique {
+	// the first click opens everything
+	SOLVE_TECHNIQUE_NONE,
+	// one number at a time: all its mines are flagged, or all its covered tiles are mines
+	SOLVE_TECHNIQUE_SINGLE,
+	// two overlapping numbers at a time, like 1-1 and 1-2 along an edge
+	SOLVE_TECHNIQUE_PATTERN,
+	// numbers combined through RREF (phase 1)
+	SOLVE_TECHNIQUE_RREF,
+	// RREF including the number of mines left (phase 2)
+	SOLVE_TECHNIQUE_GLOBAL,
+	SOLVE_TECHNIQUE_COUNT,
+} SolveTechnique;
+
+extern const char* SOLVE_TECHNIQUE_NAMES[SOLVE_TECHNIQUE_COUNT];
+
+// returns false if name isn't one of SOLVE_TECHNIQUE_NAMES
+bool SolveTechnique_Parse(const char* name, SolveTechnique*);
+
+typedef struct BoardScore {
+	// 3BV: fewest clicks that clear the board without flagging
+	int bbbv;
+	// regions of 0s, each cleared by one click
+	int nOpenings;
+	// groups of numbers no opening reaches, each needs at least one click
+	int nIslands;
+
+	// set by the generator, custom game modes leave it at SOLVE_TECHNIQUE_NONE
+	SolveTechnique technique;
+} BoardScore;
+
+// boards the default generator should produce, see State_CreateGameDefault
+typedef struct DifficultyBand {
+	bool enabled;
+	int minBBBV, maxBBBV;
+	SolveTechnique minTechnique, maxTechnique;
+	// threads sampling candidates, 0 for one per CPU
+	int nThreads;
+} DifficultyBand;
+
+// any board
+void DifficultyBand_Init(DifficultyBand*);
+bool DifficultyBand_Contains(const DifficultyBand*, const BoardScore*);
+
+// scores a board whose numbers have been counted, in a single union-find pass over the tiles
+// openings are grouped as if neighborhoods were symmetric, which every preset is
+// leaves score->technique alone
+void Difficulty_Score(const Neighborhood*, const struct Tile* tiles, int w, int h, BoardScore* score);
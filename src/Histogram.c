@@ -0,0 +1,55 @@
+#include "Histogram.h"
+
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+static int Histogram_Bucket(uint64_t value){
+	if(value < HISTOGRAM_SUB_BUCKETS) return (int) value;
+
+	int exponent = 0;
+	for(uint64_t v = value >> 1; v != 0; v >>= 1) ++exponent;
+
+	// the top HISTOGRAM_SUB_BUCKET_BITS bits below the leading 1 pick the bucket
+	int shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+	int sub = (int)(value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1);
+	return (shift + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// largest value that lands in bucket
+static uint64_t Histogram_BucketEnd(int bucket){
+	if(bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+
+	int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+	uint64_t start = (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+	return start + (((uint64_t) 1 << shift) - 1);
+}
+
+void Histogram_Record(Histogram* histogram, uint64_t value){
+	++histogram->counts[Histogram_Bucket(value)];
+	++histogram->n;
+	histogram->sum += value;
+	if(value > histogram->max) histogram->max = value;
+}
+
+uint64_t Histogram_Percentile(const Histogram* histogram, double p){
+	if(histogram->n == 0) return 0;
+
+	// rank of the value we're after, from 1 to n
+	uint64_t rank = (uint64_t)(p * histogram->n + 0.5);
+	if(rank < 1) rank = 1;
+	if(rank > histogram->n) rank = histogram->n;
+
+	uint64_t seen = 0;
+	for(int i = 0; i < HISTOGRAM_N_BUCKETS; ++i){
+		seen += histogram->counts[i];
+		if(seen >= rank){
+			// the bucket can end past anything actually recorded
+			uint64_t end = Histogram_BucketEnd(i);
+			return end < histogram->max ? end : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+double Histogram_Mean(const Histogram* histogram){
+	return histogram->n > 0 ? (double) histogram->sum / histogram->n : 0.0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <stdint.h>
+
+// counts values in buckets that widen as values grow: every power of 2 is split
+// into 2^HISTOGRAM_SUB_BUCKET_BITS buckets, so any value is off by at most 1/16th
+// covers all of uint64_t in a fixed size, recording never allocates
+typedef struct Histogram {
+	uint64_t counts[HISTOGRAM_N_BUCKETS];
+	uint64_t n;
+	uint64_t sum;
+	uint64_t max;
+} Histogram;
+
+void Histogram_Record(Histogram*, uint64_t value);
+
+// smallest value that at least p (from 0 to 1) of the recorded values don't exceed,
+// rounded up to the end of its bucket, 0 if nothing was recorded
+uint64_t Histogram_Percentile(const Histogram*, double p);
+
+double Histogram_Mean(const Histogram*);
@@ -0,0 +1,387 @@
+#include "History.h"
+#include "State.h"
+#include "Constants.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#define HISTORY_OVER 0x1
+#define HISTORY_WON 0x2
+
+// length tiles uncovered from start, or the flag at start toggled if length is 0
+// a lost game's mine is a run of its own, it's the one tile in a run that isn't counted in tilesLeft
+typedef struct HistoryDelta {
+	uint32_t start;
+	uint32_t length;
+} HistoryDelta;
+
+typedef struct HistoryMove {
+	// its deltas run up to the next move's first
+	uint32_t firstDelta;
+	// HISTORY_OVER and HISTORY_WON, before and after the move
+	uint8_t outcomeBefore, outcomeAfter;
+	// tiles changed by every move before this one, what replaying up to it costs
+	uint64_t changesBefore;
+} HistoryMove;
+
+typedef struct HistoryCheckpoint {
+	// the board after this many moves
+	int move;
+	int tilesLeft, minesFlagged;
+	uint8_t outcome;
+	// uncovered tiles, then flagged ones, a bit per tile each
+	uint64_t* bits;
+} HistoryCheckpoint;
+
+struct History {
+	HistoryMove* moves;
+	int nMoves, moveCapacity;
+	// moves before this one are on the board, the rest were undone
+	int cursor;
+	// tiles changed by all nMoves
+	uint64_t nChanges;
+
+	HistoryDelta* deltas;
+	size_t nDeltas, deltaCapacity;
+
+	// in move order, the first one is always at move 0
+	HistoryCheckpoint* checkpoints;
+	int nCheckpoints, checkpointCapacity;
+	size_t nTiles;
+
+	// the move being recorded
+	bool recording;
+	uint8_t outcomeBefore;
+	int pendingFlag;
+	// uncovered tile indices, in whatever order the flood fill got to them
+	uint32_t* pending;
+	// for sorting them
+	uint32_t* scratch;
+	size_t nPending, pendingCapacity;
+};
+
+static uint8_t History_GetOutcome(const State* state){
+	return (state->gameOver ? HISTORY_OVER : 0) | (state->gameWon ? HISTORY_WON : 0);
+}
+
+static void History_SetOutcome(State* state, uint8_t outcome){
+	bool wasOver = state->gameOver;
+	state->gameOver = outcome & HISTORY_OVER;
+	state->gameWon = outcome & HISTORY_WON;
+
+	// the clock stops when a game ends, even one that ends by being redone
+	if(!wasOver && state->gameOver) state->counterEnded = SDL_GetPerformanceCounter();
+}
+
+static uint64_t History_GetChangesBefore(const History* history, int move){
+	return move < history->nMoves ? history->moves[move].changesBefore : history->nChanges;
+}
+
+static size_t History_GetWords(const History* history){
+	return (history->nTiles + 63) / 64;
+}
+
+History* History_New(void){
+	History* history = calloc(1, sizeof(*history));
+	history->pendingFlag = -1;
+	return history;
+}
+
+static void History_DropCheckpoints(History* history, int nKept){
+	for(int i = nKept; i < history->nCheckpoints; ++i){
+		free(history->checkpoints[i].bits);
+	}
+	if(nKept < history->nCheckpoints) history->nCheckpoints = nKept;
+}
+
+void History_Free(History* history){
+	if(history == NULL) return;
+
+	History_DropCheckpoints(history, 0);
+	free(history->checkpoints);
+	free(history->moves);
+	free(history->deltas);
+	free(history->pending);
+	free(history->scratch);
+	free(history);
+}
+
+static void History_AddCheckpoint(History* history, const State* state){
+	if(history->nCheckpoints == history->checkpointCapacity){
+		history->checkpointCapacity = history->checkpointCapacity == 0 ? 8 : history->checkpointCapacity * 2;
+		history->checkpoints = realloc(history->checkpoints, history->checkpointCapacity * sizeof(*history->checkpoints));
+	}
+
+	size_t nWords = History_GetWords(history);
+	uint64_t* uncovered = calloc(2 * nWords, sizeof(uint64_t));
+	uint64_t* flagged = uncovered + nWords;
+	for(size_t i = 0; i < history->nTiles; ++i){
+		TileState tileState = state->board.tiles[i].state;
+		uint64_t bit = (uint64_t) 1 << (i % 64);
+		if(tileState & TILE_STATE_UNCOVERED) uncovered[i / 64] |= bit;
+		if(tileState & TILE_STATE_FLAG) flagged[i / 64] |= bit;
+	}
+
+	history->checkpoints[history->nCheckpoints++] = (HistoryCheckpoint) {
+		.move = history->cursor,
+		.tilesLeft = state->board.tilesLeft,
+		.minesFlagged = state->board.minesFlagged,
+		.outcome = History_GetOutcome(state),
+		.bits = uncovered,
+	};
+}
+
+void History_Clear(History* history, const State* state){
+	if(history == NULL) return;
+
+	history->nMoves = 0;
+	history->cursor = 0;
+	history->nChanges = 0;
+	history->nDeltas = 0;
+	history->recording = false;
+	history->nPending = 0;
+	history->pendingFlag = -1;
+
+	History_DropCheckpoints(history, 0);
+	history->nTiles = state->board.width * state->board.height;
+	History_AddCheckpoint(history, state);
+}
+
+void History_BeginMove(History* history, const State* state){
+	if(history == NULL) return;
+
+	history->recording = true;
+	history->outcomeBefore = History_GetOutcome(state);
+	history->nPending = 0;
+	history->pendingFlag = -1;
+}
+
+void History_RecordUncover(History* history, int index){
+	if(history == NULL || !history->recording) return;
+
+	if(history->nPending == history->pendingCapacity){
+		history->pendingCapacity = history->pendingCapacity == 0 ? 256 : history->pendingCapacity * 2;
+		history->pending = realloc(history->pending, history->pendingCapacity * sizeof(*history->pending));
+		history->scratch = realloc(history->scratch, history->pendingCapacity * sizeof(*history->scratch));
+	}
+	history->pending[history->nPending++] = (uint32_t) index;
+}
+
+void History_RecordMine(History* history, int index){
+	History_RecordUncover(history, index);
+}
+
+void History_RecordFlag(History* history, int index){
+	if(history == NULL || !history->recording) return;
+	history->pendingFlag = index;
+}
+
+// least significant byte first, only as many bytes as the largest index has,
+// so sorting costs the same per tile however big the opening is
+static void History_SortPending(History* history){
+	uint32_t* keys = history->pending;
+	size_t n = history->nPending;
+
+	if(n < 32){
+		for(size_t i = 1; i < n; ++i){
+			uint32_t key = keys[i];
+			size_t j = i;
+			for(; j > 0 && keys[j - 1] > key; --j) keys[j] = keys[j - 1];
+			keys[j] = key;
+		}
+		return;
+	}
+
+	uint32_t* from = keys;
+	uint32_t* to = history->scratch;
+	for(int shift = 0; shift < 32 && (history->nTiles - 1) >> shift != 0; shift += 8){
+		size_t offsets[256] = { 0 };
+		for(size_t i = 0; i < n; ++i) ++offsets[(from[i] >> shift) & 0xFF];
+
+		size_t offset = 0;
+		for(int b = 0; b < 256; ++b){
+			size_t count = offsets[b];
+			offsets[b] = offset;
+			offset += count;
+		}
+
+		for(size_t i = 0; i < n; ++i) to[offsets[(from[i] >> shift) & 0xFF]++] = from[i];
+
+		uint32_t* swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if(from != keys) memcpy(keys, from, n * sizeof(*keys));
+}
+
+static void History_AddDelta(History* history, uint32_t start, uint32_t length){
+	if(history->nDeltas == history->deltaCapacity){
+		history->deltaCapacity = history->deltaCapacity == 0 ? 256 : history->deltaCapacity * 2;
+		history->deltas = realloc(history->deltas, history->deltaCapacity * sizeof(*history->deltas));
+	}
+	history->deltas[history->nDeltas++] = (HistoryDelta) { start, length };
+}
+
+// a new move replaces the ones that were undone
+static void History_DropUndone(History* history){
+	if(history->cursor == history->nMoves) return;
+
+	history->nDeltas = history->moves[history->cursor].firstDelta;
+	history->nChanges = history->moves[history->cursor].changesBefore;
+	history->nMoves = history->cursor;
+
+	int nKept = 0;
+	while(nKept < history->nCheckpoints && history->checkpoints[nKept].move <= history->cursor) ++nKept;
+	History_DropCheckpoints(history, nKept);
+}
+
+void History_EndMove(History* history, const State* state){
+	if(history == NULL || !history->recording) return;
+	history->recording = false;
+
+	if(history->nPending == 0 && history->pendingFlag < 0) return;
+
+	History_DropUndone(history);
+
+	if(history->nMoves == history->moveCapacity){
+		history->moveCapacity = history->moveCapacity == 0 ? 256 : history->moveCapacity * 2;
+		history->moves = realloc(history->moves, history->moveCapacity * sizeof(*history->moves));
+	}
+	history->moves[history->nMoves] = (HistoryMove) {
+		.firstDelta = (uint32_t) history->nDeltas,
+		.outcomeBefore = history->outcomeBefore,
+		.outcomeAfter = History_GetOutcome(state),
+		.changesBefore = history->nChanges,
+	};
+
+	if(history->pendingFlag >= 0){
+		History_AddDelta(history, (uint32_t) history->pendingFlag, 0);
+		++history->nChanges;
+	}
+
+	History_SortPending(history);
+	for(size_t i = 0; i < history->nPending;){
+		uint32_t start = history->pending[i];
+		size_t end = i + 1;
+		while(end < history->nPending && history->pending[end] == start + (end - i)) ++end;
+
+		History_AddDelta(history, start, (uint32_t) (end - i));
+		i = end;
+	}
+	history->nChanges += history->nPending;
+
+	++history->nMoves;
+	history->cursor = history->nMoves;
+
+	// replaying from the last checkpoint never costs much more than restoring one
+	const HistoryCheckpoint* last = &history->checkpoints[history->nCheckpoints - 1];
+	uint64_t spacing = KET_MAX(history->nTiles / HISTORY_CHECKPOINT_FRACTION, 1);
+	if(history->nChanges - History_GetChangesBefore(history, last->move) >= spacing){
+		History_AddCheckpoint(history, state);
+	}
+}
+
+int History_GetMove(const History* history){
+	return history == NULL ? 0 : history->cursor;
+}
+
+int History_GetMoveCount(const History* history){
+	return history == NULL ? 0 : history->nMoves;
+}
+
+static void History_ApplyMove(History* history, State* state, int move, bool undo){
+	const HistoryMove* historyMove = &history->moves[move];
+	size_t end = move + 1 < history->nMoves ? history->moves[move + 1].firstDelta : history->nDeltas;
+
+	Tile* tiles = state->board.tiles;
+	for(size_t d = historyMove->firstDelta; d < end; ++d){
+		HistoryDelta delta = history->deltas[d];
+
+		if(delta.length == 0){
+			tiles[delta.start].state ^= TILE_STATE_FLAG;
+			state->board.minesFlagged += (tiles[delta.start].state & TILE_STATE_FLAG) ? 1 : -1;
+			continue;
+		}
+
+		for(uint32_t i = delta.start; i < delta.start + delta.length; ++i){
+			if(undo) tiles[i].state &= ~TILE_STATE_UNCOVERED;
+			else tiles[i].state |= TILE_STATE_UNCOVERED;
+
+			if(!(tiles[i].state & TILE_STATE_MINE)) state->board.tilesLeft += undo ? 1 : -1;
+		}
+	}
+
+	History_SetOutcome(state, undo ? historyMove->outcomeBefore : historyMove->outcomeAfter);
+}
+
+static void History_RestoreCheckpoint(History* history, State* state, const HistoryCheckpoint* checkpoint){
+	size_t nWords = History_GetWords(history);
+	const uint64_t* uncovered = checkpoint->bits;
+	const uint64_t* flagged = uncovered + nWords;
+
+	Tile* tiles = state->board.tiles;
+	for(size_t w = 0; w < nWords; ++w){
+		uint64_t u = uncovered[w], f = flagged[w];
+		size_t end = KET_MIN((w + 1) * 64, history->nTiles);
+		for(size_t i = w * 64; i < end; ++i){
+			tiles[i].state = (TileState) (
+				(tiles[i].state & ~(TILE_STATE_UNCOVERED | TILE_STATE_FLAG))
+				| (u & 1) * TILE_STATE_UNCOVERED
+				| (f & 1) * TILE_STATE_FLAG
+			);
+			u >>= 1;
+			f >>= 1;
+		}
+	}
+
+	state->board.tilesLeft = checkpoint->tilesLeft;
+	state->board.minesFlagged = checkpoint->minesFlagged;
+	History_SetOutcome(state, checkpoint->outcome);
+	history->cursor = checkpoint->move;
+}
+
+bool State_Undo(State* state){
+	History* history = state->history;
+	if(history == NULL || history->cursor == 0) return false;
+
+	--history->cursor;
+	History_ApplyMove(history, state, history->cursor, true);
+	return true;
+}
+
+bool State_Redo(State* state){
+	History* history = state->history;
+	if(history == NULL || history->cursor == history->nMoves) return false;
+
+	History_ApplyMove(history, state, history->cursor, false);
+	++history->cursor;
+	return true;
+}
+
+bool State_SeekMove(State* state, int move){
+	History* history = state->history;
+	if(history == NULL || move < 0 || move > history->nMoves) return false;
+
+	uint64_t target = History_GetChangesBefore(history, move);
+	uint64_t current = History_GetChangesBefore(history, history->cursor);
+	uint64_t stepCost = target > current ? target - current : current - target;
+
+	// the last checkpoint at or before move
+	int lo = 0, hi = history->nCheckpoints - 1;
+	while(lo < hi){
+		int mid = (lo + hi + 1) / 2;
+		if(history->checkpoints[mid].move <= move) lo = mid;
+		else hi = mid - 1;
+	}
+	const HistoryCheckpoint* checkpoint = &history->checkpoints[lo];
+	uint64_t checkpointCost = history->nTiles + target - History_GetChangesBefore(history, checkpoint->move);
+
+	if(checkpointCost < stepCost) History_RestoreCheckpoint(history, state, checkpoint);
+
+	while(history->cursor < move) State_Redo(state);
+	while(history->cursor > move) State_Undo(state);
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct State;
+
+// every move made since the game started, as the tile changes it made, for undo, redo and seeking
+//
+// a move is one click or one flag, made of deltas:
+//	tiles it uncovered, as runs of consecutive indices, so a big opening is a handful of deltas
+//	a flag it toggled
+//	the mine it uncovered if it lost the game
+// undoing or redoing a move only touches the tiles it changed
+//
+// a checkpoint of the uncovered and flagged tiles is taken every so often, so seeking
+// far away restores the closest one before it and replays the few moves after it
+//
+// mines aren't part of it, the board is generated by the first click and stays:
+// undoing the first click leaves the same board, all covered
+
+typedef struct History History;
+
+History* History_New(void);
+void History_Free(History*);
+
+// forgets every move, the board as it is now is the earliest undo goes back to
+// every History_ function does nothing if passed NULL
+void History_Clear(History*, const struct State*);
+
+// State_ClickTile and State_FlagTile record their changes between these
+// a move that changed nothing is dropped, anything else drops the moves undone before it
+void History_BeginMove(History*, const struct State*);
+void History_EndMove(History*, const struct State*);
+
+// tiles that count towards tilesLeft
+void History_RecordUncover(History*, int index);
+// a mine uncovered by a losing click
+void History_RecordMine(History*, int index);
+void History_RecordFlag(History*, int index);
+
+// moves made so far, not counting undone ones
+int History_GetMove(const History*);
+// including undone ones
+int History_GetMoveCount(const History*);
+
+// return false if there's nothing to undo or redo
+bool State_Undo(struct State*);
+bool State_Redo(struct State*);
+// to after move, 0 being the start of the game
+bool State_SeekMove(struct State*, int move);
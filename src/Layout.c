@@ -227,6 +227,9 @@ void State_RecalculateLayoutV2(State* state, int windowWidthPx, int windowHeight
 }
 
 void State_RecalculateLayout(State* state, int windowWidth, int windowHeight){
+	state->layoutSize.width = windowWidth;
+	state->layoutSize.height = windowHeight;
+
 	State_RecalculateLayoutV2(state, windowWidth, windowHeight);
 	State_RecalculateBoardLayout(state);
 }
\ No newline at end of file
@@ -2,25 +2,442 @@
 
 #include "State.h"
 #include "Win.h"
+#include "Arena.h"
+#include "Constants.h"
+#include "Watchdog.h"
+#include "Solver.h"
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <Lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
 
+// the board create_game fills in: the state's own tiles, never copied into lua
+// one per create_game call, state is only set while it runs
+typedef struct LuaBoard {
+	State* state;
+	// placed so far, the solver's total
+	int nMines;
+} LuaBoard;
+
+typedef struct LuaChunk {
+	char* data;
+	size_t size, capacity;
+} LuaChunk;
+
+static LuaBoard* LuaBoard_Check(lua_State* L, int arg){
+	LuaBoard* board = luaL_checkudata(L, arg, LUA_BOARD_METATABLE);
+	if(board->state == NULL) luaL_error(L, "the board can only be used during " LUA_CREATE_GAME_FUNCTION);
+	return board;
+}
+
+static int LuaBoard_CheckTile(lua_State* L, LuaBoard* board, int arg){
+	lua_Integer x = luaL_checkinteger(L, arg);
+	lua_Integer y = luaL_checkinteger(L, arg + 1);
+	luaL_argcheck(L, x >= 0 && x < (lua_Integer) board->state->board.width, arg, "x outside the board");
+	luaL_argcheck(L, y >= 0 && y < (lua_Integer) board->state->board.height, arg + 1, "y outside the board");
+	return (int) (x + y * board->state->board.width);
+}
+
+// board:set_mine(x, y, mine = true)
+// numbers around the tile are kept up to date, so the solver can run at any point
+static int LuaBoard_SetMine(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	int index = LuaBoard_CheckTile(L, board, 2);
+	bool mine = lua_isnone(L, 4) || lua_toboolean(L, 4);
+
+	State* state = board->state;
+	Tile* tiles = state->board.tiles;
+	if(((tiles[index].state & TILE_STATE_MINE) != 0) == mine) return 0;
+
+	if(mine) tiles[index].state |= TILE_STATE_MINE;
+	else tiles[index].state &= ~TILE_STATE_MINE;
+	board->nMines += mine ? 1 : -1;
+
+	int w = state->board.width, h = state->board.height;
+	const Neighborhood* nh = &state->game.neighborhood;
+	for(int i = 0; i < nh->n; ++i){
+		int x, y;
+		if(!Neighborhood_Referrer(nh, w, h, index % w, index / w, i, &x, &y)) continue;
+		tiles[x + y * w].surroundingMines += mine ? nh->weight[i] : -nh->weight[i];
+	}
+	return 0;
+}
+
+// board:is_mine(x, y)
+static int LuaBoard_IsMine(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	int index = LuaBoard_CheckTile(L, board, 2);
+	lua_pushboolean(L, board->state->board.tiles[index].state & TILE_STATE_MINE);
+	return 1;
+}
+
+static const struct luaL_Reg boardMethods[] = {
+	{"set_mine", LuaBoard_SetMine},
+	{"is_mine", LuaBoard_IsMine},
+	{NULL, NULL}
+};
+
+// solves the board from a click on x, y (arguments 2 and 3) as far as it gets without guessing
+// returns whether that's the whole board
+static bool Lua_Solve(lua_State* L, LuaBoard* board){
+	int index = LuaBoard_CheckTile(L, board, 2);
+	State* state = board->state;
+	luaL_argcheck(L, !(state->board.tiles[index].state & TILE_STATE_MINE), 2, "the first click can't be on a mine");
+
+	SolveState* solveState = state->game.solveState;
+	SolveState_Reset(solveState, state);
+	solveState->nMinesLeft = board->nMines;
+
+	SolveParams params = {
+		.state = solveState,
+		.tileClicked = { index % state->board.width, index / state->board.width },
+		.maxIters = 0,
+	};
+	TilePosition* unsolvableTiles;
+	size_t nUnsolvableTiles;
+	return HasSolution(&params, &unsolvableTiles, &nUnsolvableTiles);
+}
+
+// has_solution(board, x, y): whether the board can be solved without guessing from a first click on x, y
+static int Lua_HasSolution(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	lua_pushboolean(L, Lua_Solve(L, board));
+	return 1;
+}
+
+// safe_cells(board, x, y): indices (x + y * width) of every tile the solver proves safe from a first click on x, y
+static int Lua_SafeCells(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	Lua_Solve(L, board);
+
+	const SolveState* solveState = board->state->game.solveState;
+	int nTiles = solveState->w * solveState->h;
+	lua_createtable(L, nTiles - board->nMines, 0);
+	lua_Integer n = 0;
+	for(int i = 0; i < nTiles; ++i){
+		if(!SolveState_Uncovered(solveState, i)) continue;
+		lua_pushinteger(L, i);
+		lua_rawseti(L, -2, ++n);
+	}
+	return 1;
+}
+
+// mine_probability(board, x, y): after solving from a first click on x, y,
+// the chance of each tile being a mine, tile i at i + 1
+// 0 for tiles proven safe, 1 for tiles proven mines, see EstimateMineRisk for the rest
+static int Lua_MineProbability(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	Lua_Solve(L, board);
+
+	SolveState* solveState = board->state->game.solveState;
+	int nTiles = solveState->w * solveState->h;
+	// lives until the next solve, like the solver's own temporaries
+	float* risk = Arena_Alloc(&solveState->arena, nTiles * sizeof(*risk));
+	EstimateMineRisk(solveState, risk);
+
+	lua_createtable(L, nTiles, 0);
+	for(int i = 0; i < nTiles; ++i){
+		lua_Number probability = risk[i];
+		if(SolveState_Uncovered(solveState, i)) probability = 0;
+		else if(SolveState_Flagged(solveState, i)) probability = 1;
+		lua_pushnumber(L, probability);
+		lua_rawseti(L, -2, (lua_Integer) i + 1);
+	}
+	return 1;
+}
+
+// neighbor_counts(board, x, y): the number tile x, y shows, with the game mode's neighborhood
+static int Lua_NeighborCounts(lua_State* L){
+	LuaBoard* board = LuaBoard_Check(L, 1);
+	int index = LuaBoard_CheckTile(L, board, 2);
+	lua_pushinteger(L, board->state->board.tiles[index].surroundingMines);
+	return 1;
+}
+
 static const struct luaL_Reg globalFunctions[] = {
+	{"has_solution", Lua_HasSolution},
+	{"safe_cells", Lua_SafeCells},
+	{"mine_probability", Lua_MineProbability},
+	{"neighbor_counts", Lua_NeighborCounts},
 	{NULL, NULL}
 };
 
-bool State_InitLua(State* state, char* path) {
-	State_DestroyLua(state);
-	lua_State* L = luaL_newstate();
+// lua_Alloc backing the lua_State create_game runs in, see State_Lua_GenerateBoard
+// that state only lives for one call, so once lua_close has freed everything
+// the arena is reset, after every call
+// small allocations are served from size class free lists on top of a bump
+// region, reserved once and committed as it fills up, so telling an arena block
+// from a malloc one is a range check. Everything else uses malloc.
+typedef struct LuaArena {
+	char* base;
+	// bumped so far, always within committed
+	size_t used;
+	size_t committed;
+	// largest used has reached
+	size_t highWater;
+	void* freeLists[LUA_ARENA_N_SIZE_CLASSES];
+	// bytes of arena blocks that lua has not freed yet
+	size_t liveBytes;
+
+	// stats for the current/last burst
+	struct {
+		size_t nAllocs;
+		size_t bytes;
+	} burstStats;
+} LuaArena;
+
+static LuaArena* LuaArena_New(void){
+	// only address space until it's committed
+	char* base = VirtualAlloc(NULL, LUA_ARENA_RESERVE_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+	if(base == NULL) return NULL;
+
+	LuaArena* la = calloc(1, sizeof(*la));
+	la->base = base;
+	return la;
+}
+
+static void LuaArena_Free(LuaArena* la){
+	if(la == NULL) return;
+	VirtualFree(la->base, 0, MEM_RELEASE);
+	free(la);
+}
+
+// -1 if size is too big for the arena
+static int LuaArena_SizeClass(size_t size){
+	size_t blockSize = LUA_ARENA_MIN_BLOCK_SIZE;
+	for(int i = 0; i < LUA_ARENA_N_SIZE_CLASSES; ++i){
+		if(size <= blockSize) return i;
+		blockSize *= 2;
+	}
+	return -1;
+}
+
+static size_t LuaArena_BlockSize(int sizeClass){
+	return (size_t) LUA_ARENA_MIN_BLOCK_SIZE << sizeClass;
+}
+
+static bool LuaArena_Owns(const LuaArena* la, const void* ptr){
+	return (const char*) ptr >= la->base && (const char*) ptr < la->base + la->used;
+}
+
+static void* LuaArena_AllocBlock(LuaArena* la, int sizeClass){
+	size_t size = LuaArena_BlockSize(sizeClass);
+	void* block = la->freeLists[sizeClass];
+	if(block != NULL){
+		// free blocks store the next free block in their first bytes
+		la->freeLists[sizeClass] = *(void**) block;
+	}
+	else{
+		if(la->used + size > la->committed){
+			// blocks are never bigger than what's committed at once
+			if(la->committed + LUA_ARENA_CHUNK_SIZE > LUA_ARENA_RESERVE_SIZE) return NULL;
+			if(VirtualAlloc(la->base + la->committed, LUA_ARENA_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE) == NULL) return NULL;
+			la->committed += LUA_ARENA_CHUNK_SIZE;
+		}
+		// sizes are powers of 2 from 16, so every block stays aligned to its size
+		block = la->base + la->used;
+		la->used += size;
+		if(la->used > la->highWater) la->highWater = la->used;
+	}
+	la->liveBytes += size;
+	return block;
+}
+
+static void LuaArena_FreeBlock(LuaArena* la, void* block, int sizeClass){
+	*(void**) block = la->freeLists[sizeClass];
+	la->freeLists[sizeClass] = block;
+	la->liveBytes -= LuaArena_BlockSize(sizeClass);
+}
+
+static void* LuaArena_Alloc(void* ud, void* ptr, size_t osize, size_t nsize){
+	LuaArena* la = ud;
+
+	bool inArena = ptr != NULL && LuaArena_Owns(la, ptr);
+
+	if(nsize == 0){
+		if(inArena) LuaArena_FreeBlock(la, ptr, LuaArena_SizeClass(osize));
+		else free(ptr);
+		return NULL;
+	}
+
+	la->burstStats.nAllocs += 1;
+	la->burstStats.bytes += nsize;
+
+	// note: if ptr is NULL, osize is the type of object being allocated, not a size
+	if(ptr == NULL){
+		int sizeClass = LuaArena_SizeClass(nsize);
+		if(sizeClass != -1){
+			void* block = LuaArena_AllocBlock(la, sizeClass);
+			if(block != NULL) return block;
+		}
+		return malloc(nsize);
+	}
+
+	if(!inArena){
+		return realloc(ptr, nsize);
+	}
+
+	// resizing an arena block
+	int oldSizeClass = LuaArena_SizeClass(osize);
+	int newSizeClass = LuaArena_SizeClass(nsize);
+	if(oldSizeClass == newSizeClass) return ptr;
+
+	void* newPtr = NULL;
+	if(newSizeClass != -1){
+		newPtr = LuaArena_AllocBlock(la, newSizeClass);
+	}
+	if(newPtr == NULL){
+		newPtr = malloc(nsize);
+		if(newPtr == NULL) return NULL;
+	}
+
+	memcpy(newPtr, ptr, KET_MIN(osize, nsize));
+	LuaArena_FreeBlock(la, ptr, oldSizeClass);
+	return newPtr;
+}
+
+static void LuaArena_BeginBurst(LuaArena* la){
+	la->burstStats.nAllocs = 0;
+	la->burstStats.bytes = 0;
+}
+
+// after lua_close, so nothing in the arena is alive anymore
+static void LuaArena_EndBurst(LuaArena* la){
+#ifdef KET_DEBUG
+	printf(
+		"create_game: %zu allocations, %zu bytes (arena high water: %zu bytes, %zu bytes still alive)\n",
+		la->burstStats.nAllocs,
+		la->burstStats.bytes,
+		la->highWater,
+		la->liveBytes
+	);
+#endif
+
+	// what was committed stays for the next call
+	la->used = 0;
+	la->liveBytes = 0;
+	memset(la->freeLists, 0, sizeof(la->freeLists));
+}
+
+static void LuaArena_SetGCPause(lua_State* L, int pause){
+#if LUA_VERSION_NUM >= 504
+	lua_gc(L, LUA_GCINC, pause, LUA_DEFAULT_GC_STEPMUL, 0);
+#else
+	lua_gc(L, LUA_GCSETPAUSE, pause);
+	lua_gc(L, LUA_GCSETSTEPMUL, LUA_DEFAULT_GC_STEPMUL);
+#endif
+}
+
+static int LuaPanic(lua_State* L){
+	const char* msg = lua_tostring(L, -1);
+	fprintf(stderr, "Lua panic: %s\n", msg ? msg : "(error object is not a string)");
+	return 0;
+}
+
+// what every lua state the script runs in starts with
+static void Lua_OpenLibs(lua_State* L){
+	lua_atpanic(L, LuaPanic);
+
 	luaL_openlibs(L);
 	lua_getglobal(L, "_G");
 	luaL_setfuncs(L, globalFunctions, 0);
 	lua_pop(L, 1);
 
+	luaL_newmetatable(L, LUA_BOARD_METATABLE);
+	luaL_newlib(L, boardMethods);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+}
+
+// lua_Writer for lua_dump, collects the script's compiled chunk
+static int Lua_WriteChunk(lua_State* L, const void* data, size_t size, void* ud){
+	(void) L;
+	LuaChunk* chunk = ud;
+	if(chunk->size + size > chunk->capacity){
+		chunk->capacity = KET_MAX(chunk->capacity * 2, chunk->size + size);
+		chunk->data = realloc(chunk->data, chunk->capacity);
+	}
+	memcpy(chunk->data + chunk->size, data, size);
+	chunk->size += size;
+	return 0;
+}
+
+// compiles the neighborhood rule at the top of the stack into nh
+// accepts a preset name, or a table:
+//	{
+//		offsets = "knight" | { { dx, dy, weight = 1 }, ... },
+//		wrap = false,
+//	}
+static bool Lua_ReadNeighborhood(lua_State* L, Neighborhood* nh){
+	if(lua_type(L, -1) == LUA_TSTRING){
+		return Neighborhood_InitPreset(nh, lua_tostring(L, -1));
+	}
+	if(!lua_istable(L, -1)) return false;
+
+	bool success = true;
+
+	int type = lua_getfield(L, -1, LUA_NEIGHBORHOOD_OFFSETS_FIELD);
+	if(type == LUA_TSTRING){
+		success = Neighborhood_InitPreset(nh, lua_tostring(L, -1));
+	}
+	else if(type == LUA_TTABLE){
+		Neighborhood_Clear(nh);
+
+		lua_Integer nOffsets = luaL_len(L, -1);
+		for(lua_Integer i = 1; i <= nOffsets && success; ++i){
+			if(lua_geti(L, -1, i) == LUA_TTABLE){
+				lua_geti(L, -1, 1);
+				lua_geti(L, -2, 2);
+				lua_geti(L, -3, 3);
+
+				int dxIsNum, dyIsNum;
+				lua_Integer dx = lua_tointegerx(L, -3, &dxIsNum);
+				lua_Integer dy = lua_tointegerx(L, -2, &dyIsNum);
+
+				int weightIsNum = true;
+				lua_Integer weight = 1;
+				if(!lua_isnil(L, -1)) weight = lua_tointegerx(L, -1, &weightIsNum);
+
+				success = dxIsNum && dyIsNum && weightIsNum
+					&& Neighborhood_AddOffset(nh, (int) dx, (int) dy, (int) weight);
+
+				lua_pop(L, 3);
+			}
+			else{
+				success = false;
+			}
+			lua_pop(L, 1);
+		}
+
+		success = success && nh->n > 0;
+	}
+	else if(type == LUA_TNIL){
+		Neighborhood_InitMoore(nh);
+	}
+	else{
+		success = false;
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, -1, LUA_NEIGHBORHOOD_WRAP_FIELD);
+	nh->wrap = lua_toboolean(L, -1);
+	lua_pop(L, 1);
+
+	return success;
+}
+
+bool State_InitLua(State* state, char* path) {
+	State_DestroyLua(state);
+
+	lua_State* L = luaL_newstate();
+	if(L == NULL) return false;
+	Lua_OpenLibs(L);
+
 	state->game.lua.state = L;
 	state->game.lua.createGameRef = LUA_NOREF;
 	state->game.lua.generateMinesRef = LUA_NOREF;
@@ -28,6 +445,9 @@ bool State_InitLua(State* state, char* path) {
 
 	bool initSuccessfully = true;
 
+	Neighborhood neighborhood;
+	Neighborhood_InitMoore(&neighborhood);
+
 	bool error;
 	error = luaL_loadfile(L, path);
 	if(error){
@@ -36,6 +456,12 @@ bool State_InitLua(State* state, char* path) {
 		initSuccessfully = false;
 	}
 	else{
+		// create_game runs it again in a state of its own every time
+		LuaChunk chunk = { 0 };
+		lua_dump(L, Lua_WriteChunk, &chunk, 0);
+		state->game.lua.chunk = chunk.data;
+		state->game.lua.chunkSize = chunk.size;
+
 		error = lua_pcall(L, 0, 1, 0);
 		if(error){
 			printf("Could not run file: %s\n", lua_tostring(L, -1));
@@ -47,6 +473,11 @@ bool State_InitLua(State* state, char* path) {
 				type = lua_getfield(L, -1, LUA_CREATE_GAME_FUNCTION);
 				if(type == LUA_TFUNCTION){
 					state->game.lua.createGameRef = luaL_ref(L,  LUA_REGISTRYINDEX);
+					state->game.lua.arena = LuaArena_New();
+					if(state->game.lua.arena == NULL){
+						MessageBoxW(NULL, L"Could not reserve memory for \"" LUA_CREATE_GAME_FUNCTIONW L"\".", L"Lua import error", MB_OK | MB_ICONEXCLAMATION);
+						initSuccessfully = false;
+					}
 				}
 				else{
 					lua_pop(L, 1);
@@ -68,17 +499,36 @@ bool State_InitLua(State* state, char* path) {
 					lua_pop(L, 1);
 				}
 
+				bool hasNeighborhood = false;
+				type = lua_getfield(L, -1, LUA_NEIGHBORHOOD_FIELD);
+				if(type != LUA_TNIL){
+					hasNeighborhood = true;
+					if(!Lua_ReadNeighborhood(L, &neighborhood)){
+						MessageBoxW(
+							NULL,
+							L"\"" LUA_NEIGHBORHOOD_FIELDW L"\" must be a preset name (\"moore\", \"cross\", \"knight\") "
+							L"or a table of offsets { dx, dy, weight } with weights adding up to at most 8.",
+							L"Lua import error",
+							MB_OK | MB_ICONEXCLAMATION
+						);
+						initSuccessfully = false;
+					}
+				}
+				lua_pop(L, 1);
+
 				if(
 					state->game.lua.createGameRef == LUA_NOREF
 					&& state->game.lua.generateMinesRef == LUA_NOREF
 					&& state->game.lua.countMinesRef == LUA_NOREF
+					&& !hasNeighborhood
 				){
 					MessageBoxW(
 						NULL,
 						L"Lua file does not return a table with one or more of: "
 						L"\"" LUA_CREATE_GAME_FUNCTIONW L"\", "
 						L"\"" LUA_GENERATE_MINES_FUNCTIONW L"\", "
-						L"\"" LUA_COUNT_MINES_FUNCTIONW L"\".",
+						L"\"" LUA_COUNT_MINES_FUNCTIONW L"\", "
+						L"\"" LUA_NEIGHBORHOOD_FIELDW L"\".",
 						L"Lua import error",
 						MB_OK | MB_ICONEXCLAMATION
 					);
@@ -92,7 +542,8 @@ bool State_InitLua(State* state, char* path) {
 		}
 	}
 
-	if(!initSuccessfully) lua_close(L);
+	if(initSuccessfully) State_SetNeighborhood(state, &neighborhood);
+	else State_DestroyLua(state);
 	return initSuccessfully;
 }
 
@@ -155,28 +606,110 @@ void State_Lua_MessageBoxError(State* state, const wchar_t* functionName){
 	free(wMsg);
 }
 
+// the default generator keeps mines out of the tiles around the first click, so must create_game
+static bool State_Lua_SafeAreaHasMine(const State* state, int tileX, int tileY){
+	int width = state->board.width, height = state->board.height;
+	for(int y = KET_MAX(tileY - BOARD_CLICK_SAFE_AREA + 1, 0); y < KET_MIN(tileY + BOARD_CLICK_SAFE_AREA, height); ++y){
+		for(int x = KET_MAX(tileX - BOARD_CLICK_SAFE_AREA + 1, 0); x < KET_MIN(tileX + BOARD_CLICK_SAFE_AREA, width); ++x){
+			if(state->board.tiles[x + y * width].state & TILE_STATE_MINE) return true;
+		}
+	}
+	return false;
+}
+
+// runs the script again in L, then its create_game on state's board
+// returns false with the error on top of L's stack
+static bool Lua_CallCreateGame(lua_State* L, State* state, int tileX, int tileY, int* nMines){
+	// generation is short, so don't let incremental gc steps interrupt it
+	// unless the heap actually gets big
+	LuaArena_SetGCPause(L, LUA_ARENA_GC_PAUSE);
+	Lua_OpenLibs(L);
+
+	LuaBoard* board = lua_newuserdata(L, sizeof(*board));
+	*board = (LuaBoard) { 0 };
+	luaL_setmetatable(L, LUA_BOARD_METATABLE);
+
+	if(
+		luaL_loadbufferx(L, state->game.lua.chunk, state->game.lua.chunkSize, LUA_CREATE_GAME_FUNCTION, "b") != LUA_OK
+		|| lua_pcall(L, 0, 1, 0) != LUA_OK
+	){
+		return false;
+	}
+	if(!lua_istable(L, -1) || lua_getfield(L, -1, LUA_CREATE_GAME_FUNCTION) != LUA_TFUNCTION){
+		lua_pushliteral(L, "the script didn't return it this time");
+		return false;
+	}
+
+	lua_pushinteger(L, state->board.width);
+	lua_pushinteger(L, state->board.height);
+	lua_pushinteger(L, state->board.nMines);
+	lua_pushinteger(L, tileX);
+	lua_pushinteger(L, tileY);
+	lua_pushvalue(L, 1);
+
+	board->state = state;
+	int error = lua_pcall(L, 6, 1, 0);
+	board->state = NULL;
+
+	*nMines = board->nMines;
+	return error == LUA_OK;
+}
+
 bool State_Lua_GenerateBoard(State* state, int tileX, int tileY) {
 	lua_State* L = state->game.lua.state;
 
-	int type = lua_rawgeti(L, LUA_REGISTRYINDEX, state->game.lua.createGameRef);
-	if(type == LUA_TFUNCTION){
-		lua_pushinteger(L, state->board.width);
-		lua_pushinteger(L, state->board.height);
-		lua_pushinteger(L, state->board.nMines);
-		lua_pushinteger(L, tileX);
-		lua_pushinteger(L, tileY);
-		int error = lua_pcall(L, 5, 1, 0);
-		if(error){
+	if(state->game.lua.createGameRef != LUA_NOREF){
+		// a failed create_game may have left mines behind
+		State_ClearBoard(state);
+
+		WatchdogPhase phase = Watchdog_SetPhase(state->watchdog, WATCHDOG_PHASE_LUA);
+		LuaArena_BeginBurst(state->game.lua.arena);
+
+		// a state of its own, all of it in the arena, so nothing create_game
+		// leaves behind outlives the call and the arena is always reset
+		int nMines = 0;
+		lua_State* G = lua_newstate(LuaArena_Alloc, state->game.lua.arena);
+		bool success = G != NULL && Lua_CallCreateGame(G, state, tileX, tileY, &nMines);
+
+		// the error is copied out before the state that made it goes
+		if(G == NULL) lua_pushliteral(L, "not enough memory");
+		else if(!success){
+			const char* msg = lua_tostring(G, -1);
+			lua_pushstring(L, msg != NULL ? msg : "(error object is not a string)");
+		}
+		if(G != NULL) lua_close(G);
+
+		LuaArena_EndBurst(state->game.lua.arena);
+		Watchdog_SetPhase(state->watchdog, phase);
+
+		if(!success){
 			State_Lua_MessageBoxError(state, LUA_CREATE_GAME_FUNCTIONW);
 			lua_pop(L, 1);
 			return false;
 		}
-		else{
+
+		if(nMines == 0){
+			// only wanted to see the click, or to change the rules
+			return State_CreateGameDefault(state, tileX, tileY);
+		}
+		else if(nMines != state->board.nMines){
+			lua_pushfstring(L, "placed %d mines instead of %d", nMines, state->board.nMines);
+			State_Lua_MessageBoxError(state, LUA_CREATE_GAME_FUNCTIONW);
+			lua_pop(L, 1);
+			return false;
+		}
+		else if(State_Lua_SafeAreaHasMine(state, tileX, tileY)){
+			lua_pushfstring(L, "placed a mine next to the first click at %d, %d", tileX, tileY);
+			State_Lua_MessageBoxError(state, LUA_CREATE_GAME_FUNCTIONW);
 			lua_pop(L, 1);
+			return false;
+		}
+		else{
+			State_GenerateFlagsDefault(state);
 		}
 	}
 	else{
-		State_CreateGameDefault(state, tileX, tileY);
+		return State_CreateGameDefault(state, tileX, tileY);
 	}
 
 	return true;
@@ -192,5 +725,13 @@ void State_DestroyLua(State* state){
 		luaL_unref(L, LUA_REGISTRYINDEX, state->game.lua.countMinesRef);
 
 		lua_close(L);
+		state->game.lua.state = NULL;
 	}
+
+	free(state->game.lua.chunk);
+	state->game.lua.chunk = NULL;
+	state->game.lua.chunkSize = 0;
+
+	LuaArena_Free(state->game.lua.arena);
+	state->game.lua.arena = NULL;
 }
\ No newline at end of file
@@ -5,10 +5,15 @@
 #define LUA_CREATE_GAME_FUNCTION "create_game"
 #define LUA_GENERATE_MINES_FUNCTION "generate_mines"
 #define LUA_COUNT_MINES_FUNCTION "count_mines"
+#define LUA_NEIGHBORHOOD_FIELD "neighborhood"
+#define LUA_NEIGHBORHOOD_OFFSETS_FIELD "offsets"
+#define LUA_NEIGHBORHOOD_WRAP_FIELD "wrap"
+#define LUA_BOARD_METATABLE "ket.board"
 
 #define LUA_CREATE_GAME_FUNCTIONW L"create_game"
 #define LUA_GENERATE_MINES_FUNCTIONW L"generate_mines"
 #define LUA_COUNT_MINES_FUNCTIONW L"count_mines"
+#define LUA_NEIGHBORHOOD_FIELDW L"neighborhood"
 
 struct State;
 
@@ -1,18 +1,37 @@
 #include <SDL.h>
 
 #include <stdbool.h>
-
-#ifdef KET_DEBUG
 #include <stdio.h>
-#endif
+#include <stdlib.h>
+#include <string.h>
 
 #include "State.h"
+#include "Constants.h"
 #include "Solver.h"
 
 #include "Win.h"
 #include <conio.h>
 
 #include "Lua.h"
+#include "Timeline.h"
+#include "Replay.h"
+#include "Autoplay.h"
+#include "Server.h"
+#include "Thumbnail.h"
+#include "Repair.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Watchdog.h"
+
+// release builds have no console of their own
+static void AttachParentConsole(void){
+#ifndef KET_DEBUG
+	if(AttachConsole(ATTACH_PARENT_PROCESS)){
+		freopen("CONOUT$", "w", stdout);
+		freopen("CONOUT$", "w", stderr);
+	}
+#endif
+}
 
 int main(int argc, char* argv[]){
 #ifdef KET_DEBUG
@@ -22,6 +41,115 @@ int main(int argc, char* argv[]){
 	}
 #endif
 
+	// --record <file>: write every handled input to file
+	// --replay <file> [--repeat n]: run a recording headless n times and print throughput
+	// --autoplay <games> [--threads n] [--difficulty easy|medium|hard]: let the solver play headless
+	// --3bv <min>:<max> and --technique <min>[:<max>]: only generate boards in this difficulty band
+	// --serve <socket> [--threads n]: host games for bots over a Unix domain socket, see Server.h
+	// --thumbnails <list> <dir> [--threads n] [--thumbnail-size <width>x<height>]: render the saved games listed to PNGs
+	// --bench-generation <boards> [--difficulty ...]: compare repairing unsolvable boards with starting over
+	// --board <width>x<height>:<mines> instead of --difficulty
+	// --trace <file>: write trace spans there on exit, or when F12 is pressed (builds with KET_TRACE only)
+	// --metrics <file>: keep rewriting latency histograms there, in Prometheus' text format
+	// --watchdog <ms>: log main loop stalls longer than this, 0 turns the watchdog off
+	// --stall-log <file>: append stalls there instead of to stderr
+	const char* recordPath = NULL;
+	const char* tracePath = NULL;
+	const char* metricsPath = NULL;
+	const char* stallLogPath = NULL;
+	int watchdogMs = WATCHDOG_STALL_MS;
+	const char* replayPath = NULL;
+	const char* servePath = NULL;
+	const char* thumbnailListPath = NULL;
+	const char* thumbnailDir = NULL;
+	int thumbnailWidth = THUMBNAIL_WIDTH, thumbnailHeight = THUMBNAIL_HEIGHT;
+	int nReplayRepeats = 1;
+	int nAutoplayGames = 0;
+	int nAutoplayThreads = SDL_GetCPUCount();
+	int nBenchBoards = 0;
+	int boardWidth = BOARD_WIDTH_HARD, boardHeight = BOARD_HEIGHT_HARD, boardMines = BOARD_N_MINES_HARD;
+	DifficultyBand band;
+	DifficultyBand_Init(&band);
+	for(int i = 1; i < argc; ++i){
+		if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+		else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+		else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) nReplayRepeats = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--serve") == 0 && i + 1 < argc) servePath = argv[++i];
+		else if(strcmp(argv[i], "--thumbnails") == 0 && i + 2 < argc){
+			thumbnailListPath = argv[++i];
+			thumbnailDir = argv[++i];
+		}
+		else if(strcmp(argv[i], "--thumbnail-size") == 0 && i + 1 < argc){
+			sscanf(argv[++i], "%dx%d", &thumbnailWidth, &thumbnailHeight);
+		}
+		else if(strcmp(argv[i], "--autoplay") == 0 && i + 1 < argc) nAutoplayGames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) nAutoplayThreads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--bench-generation") == 0 && i + 1 < argc) nBenchBoards = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+		else if(strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metricsPath = argv[++i];
+		else if(strcmp(argv[i], "--watchdog") == 0 && i + 1 < argc) watchdogMs = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--stall-log") == 0 && i + 1 < argc) stallLogPath = argv[++i];
+		else if(strcmp(argv[i], "--board") == 0 && i + 1 < argc){
+			sscanf(argv[++i], "%dx%d:%d", &boardWidth, &boardHeight, &boardMines);
+		}
+		else if(strcmp(argv[i], "--3bv") == 0 && i + 1 < argc){
+			band.enabled = sscanf(argv[++i], "%d:%d", &band.minBBBV, &band.maxBBBV) == 2;
+		}
+		else if(strcmp(argv[i], "--technique") == 0 && i + 1 < argc){
+			char* names = argv[++i];
+			char* separator = strchr(names, ':');
+			if(separator != NULL) *separator = '\0';
+
+			band.enabled = SolveTechnique_Parse(names, &band.minTechnique)
+				&& SolveTechnique_Parse(separator != NULL ? separator + 1 : names, &band.maxTechnique);
+		}
+		else if(strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc){
+			const char* difficulty = argv[++i];
+			if(strcmp(difficulty, "easy") == 0){
+				boardWidth = BOARD_WIDTH_EASY, boardHeight = BOARD_HEIGHT_EASY, boardMines = BOARD_N_MINES_EASY;
+			}
+			else if(strcmp(difficulty, "medium") == 0){
+				boardWidth = BOARD_WIDTH_MEDIUM, boardHeight = BOARD_HEIGHT_MEDIUM, boardMines = BOARD_N_MINES_MEDIUM;
+			}
+			else if(strcmp(difficulty, "hard") == 0){
+				boardWidth = BOARD_WIDTH_HARD, boardHeight = BOARD_HEIGHT_HARD, boardMines = BOARD_N_MINES_HARD;
+			}
+		}
+	}
+
+	if(replayPath != NULL){
+		AttachParentConsole();
+		bool replayed = Replay_Run(replayPath, KET_MAX(nReplayRepeats, 1));
+		if(tracePath != NULL) Trace_Dump(tracePath);
+		return replayed ? 0 : 1;
+	}
+
+	if(nBenchBoards > 0){
+		AttachParentConsole();
+		Repair_Bench(nBenchBoards, boardWidth, boardHeight, boardMines);
+		if(tracePath != NULL) Trace_Dump(tracePath);
+		return 0;
+	}
+
+	if(servePath != NULL){
+		AttachParentConsole();
+		return Server_Run(servePath, KET_MAX(nAutoplayThreads, 1)) ? 0 : 1;
+	}
+
+	if(thumbnailListPath != NULL){
+		AttachParentConsole();
+		bool rendered = Thumbnail_Run(thumbnailListPath, thumbnailDir, KET_MAX(nAutoplayThreads, 1), thumbnailWidth, thumbnailHeight);
+		if(tracePath != NULL) Trace_Dump(tracePath);
+		return rendered ? 0 : 1;
+	}
+
+	if(nAutoplayGames > 0){
+		AttachParentConsole();
+		bool played = Autoplay_Run(nAutoplayGames, KET_MAX(nAutoplayThreads, 1), boardWidth, boardHeight, boardMines, &band);
+		if(tracePath != NULL) Trace_Dump(tracePath);
+		return played ? 0 : 1;
+	}
+
 	// Tile tiles[] = {
 	// 	{1, 0}, {1, 0}, {1, 0},
 	// 	{1, 1}, {1, 2}, {1, 2},
@@ -85,6 +213,8 @@ int main(int argc, char* argv[]){
 	// _getch();
 	// return 0;
 
+	Timeline_Start();
+
 	State state;
 	State* statePtr = &state;
 	if(!State_Init(statePtr)){
@@ -92,22 +222,51 @@ int main(int argc, char* argv[]){
 		return 1;
 	}
 
+	statePtr->game.band = band;
+	statePtr->tracePath = tracePath;
+	if(metricsPath != NULL) statePtr->metrics = Metrics_New(metricsPath);
+	if(recordPath != NULL) State_StartRecording(statePtr, recordPath);
+	if(watchdogMs > 0){
+		statePtr->watchdog = Watchdog_Start(watchdogMs, stallLogPath, statePtr->game.solveState);
+		Watchdog_SetBoard(
+			statePtr->watchdog,
+			(int) statePtr->board.width,
+			(int) statePtr->board.height,
+			statePtr->board.nMines,
+			statePtr->game.mode != GAMEMODE_DEFAULT,
+			statePtr->game.seed
+		);
+	}
+
 	bool shouldQuit = false;
 	while(!shouldQuit && !statePtr->shouldQuit) {
+		Watchdog_SetPhase(statePtr->watchdog, WATCHDOG_PHASE_EVENTS);
 		SDL_Event event;
 		while(SDL_PollEvent(&event)){
+			// SDL pumps window messages into the queue inside this same call and only stamps
+			// them in ms, so the counter right now is as early and a lot finer
+			uint64_t arrived = SDL_GetPerformanceCounter();
 			if(event.type == SDL_QUIT) {
 				shouldQuit = 1;
 				break;
 			}
 			else{
-				State_HandleEvent(statePtr, &event);
+				State_HandleEvent(statePtr, &event, arrived);
 			}
 		}
 
+		Watchdog_SetPhase(statePtr->watchdog, WATCHDOG_PHASE_FRAME);
 		State_Update(statePtr);
+
+		Watchdog_SetPhase(statePtr->watchdog, WATCHDOG_PHASE_IDLE);
+		Watchdog_Heartbeat(statePtr->watchdog);
 	}
 
+	if(tracePath != NULL) Trace_Dump(tracePath);
+	if(statePtr->metrics != NULL) Metrics_Write(statePtr->metrics);
+#ifdef KET_DEBUG
+	State_PrintLatency(statePtr);
+#endif
 	State_Destroy(statePtr);
 
 #ifdef KET_DEBUG
@@ -1,6 +1,9 @@
 #include "Matrix.h"
+#include "Arena.h"
+#include "Trace.h"
 
 #include <stdio.h>
+#include <string.h>
 
 Matrix* Matrix_New(size_t r, size_t c) {
 	Matrix* matrix = malloc(sizeof(*matrix));
@@ -12,12 +15,23 @@ Matrix* Matrix_New(size_t r, size_t c) {
 	return matrix;
 }
 
+Matrix* Matrix_NewInArena(Arena* arena, size_t r, size_t c) {
+	Matrix* matrix = Arena_Alloc(arena, sizeof(*matrix));
+
+	matrix->r = r;
+	matrix->c = c;
+	matrix->data = Arena_Alloc(arena, r * c * sizeof(int));
+	memset(matrix->data, 0, r * c * sizeof(int));
+
+	return matrix;
+}
+
 int* Matrix_Get(Matrix* matrix, size_t r, size_t c) {
 	return matrix->data + c + r * matrix->c;
 }
 
 //https://www.cfm.brown.edu/people/dobrush/cs52/Mathematica/Part1/rref.html
-void Matrix_RREF(Matrix* mat){
+static void Matrix_Eliminate(Matrix* mat){
     // lead = 0
     // rowCount = len(M)
     // columnCount = len(M[0])
@@ -54,16 +68,42 @@ void Matrix_RREF(Matrix* mat){
 			}
 		}
 		Matrix_SwapRows(mat, i, r);
-		// we don't need to scale because all entries are 1
+
+		// we stay in integers, so instead of dividing the pivot row by the pivot,
+		// other rows get scaled by it (fraction-free elimination)
+		// with all coefficients 1 the pivot is usually 1 and this is plain subtraction
+		int pivot = *Matrix_Get(mat, r, lead);
+		if(pivot < 0){
+			Matrix_ScaleRow(mat, r, -1);
+			pivot = -pivot;
+		}
+
 		for(i = 0; i < mat->r; ++i){
 			if (i != r){
-				Matrix_SubRows(mat, i, r, *Matrix_Get(mat, i, lead));
+				int v = *Matrix_Get(mat, i, lead);
+				if(v == 0) continue;
+
+				if(pivot != 1){
+					Matrix_ScaleRow(mat, i, pivot);
+				}
+				Matrix_SubRows(mat, i, r, v);
+				if(pivot != 1){
+					Matrix_ReduceRow(mat, i);
+				}
 			}
 		}
 		++lead;
 	}
 }
 
+void Matrix_RREF(Matrix* mat){
+	TRACE_BEGIN("Matrix_RREF");
+	TRACE_ARG("rows", mat->r);
+	TRACE_ARG("columns", mat->c);
+	Matrix_Eliminate(mat);
+	TRACE_END();
+}
+
 void Matrix_SwapRows(Matrix* mat, int r1, int r2){
 	for(int c = 0; c < mat->c; ++c){
 		int tmp = *Matrix_Get(mat, r1, c);
@@ -72,6 +112,35 @@ void Matrix_SwapRows(Matrix* mat, int r1, int r2){
 	}
 }
 
+void Matrix_ScaleRow(Matrix* mat, int r, int scale){
+	for(int c = 0; c < mat->c; ++c){
+		*Matrix_Get(mat, r, c) *= scale;
+	}
+}
+
+static int GCD(int a, int b){
+	a = abs(a);
+	b = abs(b);
+	while(b != 0){
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+void Matrix_ReduceRow(Matrix* mat, int r){
+	int gcd = 0;
+	for(int c = 0; c < mat->c; ++c){
+		gcd = GCD(gcd, *Matrix_Get(mat, r, c));
+	}
+	if(gcd > 1){
+		for(int c = 0; c < mat->c; ++c){
+			*Matrix_Get(mat, r, c) /= gcd;
+		}
+	}
+}
+
 void Matrix_SubRows(Matrix* mat, int r1, int r2, int scale) {
 	for(int c = 0; c < mat->c; ++c){
 		*Matrix_Get(mat, r1, c) = *Matrix_Get(mat, r1, c) - *Matrix_Get(mat, r2, c) * scale;
@@ -2,12 +2,16 @@
 
 #include <stdlib.h>
 
+struct Arena;
+
 typedef struct Matrix {
 	size_t r, c;
 	int* data;
 } Matrix;
 
 Matrix* Matrix_New(size_t r, size_t c);
+// zeroed like Matrix_New, freed with the arena instead of Matrix_Free
+Matrix* Matrix_NewInArena(struct Arena*, size_t r, size_t c);
 
 int* Matrix_Get(Matrix*, size_t r, size_t c);
 
@@ -16,7 +20,10 @@ void Matrix_Print(Matrix*);
 void Matrix_RREF(Matrix*);
 
 void Matrix_SwapRows(Matrix*, int r1, int r2);
-// void Matrix_ScaleRow(Matrix*, int r, int scale);
+void Matrix_ScaleRow(Matrix*, int r, int scale);
+
+// divide row by the gcd of its entries
+void Matrix_ReduceRow(Matrix*, int r);
 
 // r1 = r1 - r1
 void Matrix_SubRows(Matrix*, int r1, int r2, int scale);
@@ -2,6 +2,7 @@
 #include "State.h"
 #include "Constants.h"
 #include "Resources.h"
+#include "Snapshot.h"
 
 #include <SDL2/SDL.h>
 #include <SDL_syswm.h>
@@ -95,17 +96,85 @@ void State_UncheckTheme(State* state){
 	);
 }
 
-LPWSTR State_CreateFileDialog(State* state, COMDLG_FILTERSPEC* filters, size_t nFilters, LPCWSTR defaultExtension){
+void State_CheckCustomTheme(State* state, LPCWSTR fileName){
+	State_UncheckTheme(state);
+	CheckMenuItem(
+		state->menu,
+		IDM_THEME_CUSTOM,
+		MF_BYCOMMAND | MF_CHECKED
+	);
+
+	size_t newMenuTextLength = sizeof(MENU_DEFAULT_CUSTOM_THEME_TEXT)/sizeof(*MENU_DEFAULT_CUSTOM_THEME_TEXT) // Default
+		+ 1 // \t
+		+ wcslen(fileName) // filename
+		+ 2;// quotes
+
+	LPWSTR newMenuText = malloc((newMenuTextLength + 1) * sizeof(*newMenuText));
+	swprintf_s(newMenuText, newMenuTextLength + 1, L"%s\t\"%s\"", MENU_DEFAULT_CUSTOM_THEME_TEXT, fileName);
+
+	MENUITEMINFOW info = {
+		.cbSize = sizeof(MENUITEMINFOW),
+		.fMask = MIIM_STRING,
+		.dwTypeData = newMenuText,
+		.cch = newMenuTextLength
+	};
+
+	SetMenuItemInfoW(
+		state->menu,
+		IDM_THEME_CUSTOM,
+		false,
+		&info
+	);
+
+	free(newMenuText);
+}
+
+// checks Custom, labeled with the current board
+void State_CheckCustomDifficulty(State* state){
+	State_UncheckDifficulty(state);
+	CheckMenuItem(
+		state->menu,
+		IDM_CUSTOM,
+		MF_BYCOMMAND | MF_CHECKED
+	);
+
+	wchar_t newCustomDifficultyText[sizeof("000x000, 000 mines") + 1];
+	swprintf(
+		newCustomDifficultyText,
+		sizeof(newCustomDifficultyText)/sizeof(*newCustomDifficultyText) - 1,
+		L"%ux%u, %u mines",
+		(unsigned int) state->board.width,
+		(unsigned int) state->board.height,
+		(unsigned int) state->board.nMines
+	);
+
+	MENUITEMINFOW info = {
+		.cbSize = sizeof(MENUITEMINFOW),
+		.fMask = MIIM_STRING,
+		.dwTypeData = newCustomDifficultyText,
+		.cch = wcslen(newCustomDifficultyText),
+	};
+
+	SetMenuItemInfoW(
+		state->menu,
+		IDM_CUSTOM,
+		false,
+		&info
+	);
+}
+
+// save picks where to write instead of an existing file
+LPWSTR State_CreateFileDialog(State* state, COMDLG_FILTERSPEC* filters, size_t nFilters, LPCWSTR defaultExtension, bool save){
 	LPWSTR filePathOut = NULL;
 
 	// state->images.tilesheet.texture = state->images.tilesheet.sourceTextures.original;
 	// FILE DIALOGUE
-	IFileOpenDialog* fileDialog = NULL;
+	IFileDialog* fileDialog = NULL;
 	HRESULT hr = CoCreateInstance(
-		&CLSID_FileOpenDialog,
+		save ? &CLSID_FileSaveDialog : &CLSID_FileOpenDialog,
 		NULL,
 		CLSCTX_INPROC_SERVER,
-		&IID_IFileOpenDialog,
+		&IID_IFileDialog,
 		&(void*) fileDialog
 	);
 	if(SUCCEEDED(hr)){
@@ -174,6 +243,36 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 	if(id == IDM_EXIT){
 		state->shouldQuit = true;
 	}
+	else if(id == IDM_SAVE || id == IDM_OPEN){
+		COMDLG_FILTERSPEC filters[] = {
+			{
+				.pszName = L"Saved game",
+				.pszSpec = L"*.ketsave",
+			},
+		};
+		LPWSTR filePath = State_CreateFileDialog(state, filters, sizeof(filters)/sizeof(*filters), L"ketsave", id == IDM_SAVE);
+
+		if(filePath != NULL){
+			if(id == IDM_SAVE){
+				if(!State_SaveSnapshot(state, filePath)){
+					MessageBoxW(NULL, L"Could not save the game.", L"Save game", MB_OK | MB_ICONEXCLAMATION);
+				}
+			}
+			else if(State_LoadSnapshot(state, filePath)){
+				State_CheckCustomDifficulty(state);
+			}
+			else{
+				MessageBoxW(
+					NULL,
+					L"Could not open the game. It may be damaged, or saved with another game mode's rules.",
+					L"Open game",
+					MB_OK | MB_ICONEXCLAMATION
+				);
+			}
+
+			CoTaskMemFree(filePath);
+		}
+	}
 	else if(id == IDM_EASY){
 		state->board.nMines = BOARD_N_MINES_EASY;
 		state->board.width = BOARD_WIDTH_EASY;
@@ -227,36 +326,7 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 			state->board.height = res->height;
 			State_ResetBoard(state);
 
-			State_UncheckDifficulty(state);
-			CheckMenuItem(
-				state->menu,
-				IDM_CUSTOM,
-				MF_BYCOMMAND | MF_CHECKED
-			);
-
-			wchar_t newCustomDifficultyText[sizeof("000x000, 000 mines") + 1];
-			swprintf(
-				newCustomDifficultyText,
-				sizeof(newCustomDifficultyText)/sizeof(*newCustomDifficultyText) - 1,
-				L"%ux%u, %u mines",
-				res->width,
-				res->height,
-				res->nMines
-			);
-
-			MENUITEMINFOW info = {
-				.cbSize = sizeof(MENUITEMINFOW),
-				.fMask = MIIM_STRING,
-				.dwTypeData = newCustomDifficultyText,
-				.cch = wcslen(newCustomDifficultyText),
-			};
-
-			SetMenuItemInfoW(
-				state->menu,
-				IDM_CUSTOM,
-				false,
-				&info
-			);
+			State_CheckCustomDifficulty(state);
 
 			free(res);
 		}
@@ -271,7 +341,10 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 			MF_BYCOMMAND | MF_CHECKED
 		);
 	} else if(id == IDM_THEME_CUTE){
-		state->images.tilesheet.texture = state->images.tilesheet.sourceTextures.cute;
+		SDL_Texture* cuteTexture = State_GetCuteTexture(state);
+		if(cuteTexture == NULL) return;
+
+		state->images.tilesheet.texture = cuteTexture;
 		State_UpdateBackgroundColor(state);
 
 		State_UncheckTheme(state);
@@ -287,7 +360,7 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 				.pszSpec = L"*.png",
 			},
 		};
-		LPWSTR filePath = State_CreateFileDialog(state, filters, sizeof(filters)/sizeof(*filters), L"png");
+		LPWSTR filePath = State_CreateFileDialog(state, filters, sizeof(filters)/sizeof(*filters), L"png", false);
 
 		if(filePath != NULL){
 			int mbBufferSize = WideCharToMultiByte(
@@ -306,47 +379,8 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 			);
 
 			if(mbBufferSize != 0){
-				SDL_Texture* newCustomTexture = State_LoadTextureFromPath(state, filePathMB);
-				if(state->images.tilesheet.sourceTextures.custom != NULL) {
-					SDL_DestroyTexture(state->images.tilesheet.sourceTextures.custom);
-				}
-				state->images.tilesheet.sourceTextures.custom = newCustomTexture;
-				state->images.tilesheet.texture = newCustomTexture;
-
-				State_UpdateBackgroundColor(state);
-
-				LPWSTR fileName = PathFindFileNameW(filePath);
-
-				State_UncheckTheme(state);
-				CheckMenuItem(
-					state->menu,
-					IDM_THEME_CUSTOM,
-					MF_BYCOMMAND | MF_CHECKED
-				);
-
-				size_t newMenuTextLength = sizeof(MENU_DEFAULT_CUSTOM_THEME_TEXT)/sizeof(*MENU_DEFAULT_CUSTOM_THEME_TEXT) // Default
-					+ 1 // \t
-					+ wcslen(fileName) // filename
-					+ 2;// quotes
-
-				LPWSTR newMenuText = malloc((newMenuTextLength + 1) * sizeof(*newMenuText));
-				swprintf_s(newMenuText, newMenuTextLength + 1, L"%s\t\"%s\"", MENU_DEFAULT_CUSTOM_THEME_TEXT, fileName);
-
-				MENUITEMINFOW info = {
-					.cbSize = sizeof(MENUITEMINFOW),
-					.fMask = MIIM_STRING,
-					.dwTypeData = newMenuText,
-					.cch = newMenuTextLength
-				};
-
-				SetMenuItemInfoW(
-					state->menu,
-					IDM_THEME_CUSTOM,
-					false,
-					&info
-				);
-
-				free(newMenuText);
+				// decoded and selected in the background, see State_PollCustomTheme
+				State_LoadCustomTheme(state, filePath, filePathMB);
 			}
 			else{
 				printf("Could not convert wstr to mbstr\n");
@@ -358,6 +392,9 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 	} else if(id == IDM_GAMEMODE_DEFAULT){
 		if(state->game.mode != GAMEMODE_DEFAULT){
 			state->game.mode = GAMEMODE_DEFAULT;
+			Neighborhood moore;
+			Neighborhood_InitMoore(&moore);
+			State_SetNeighborhood(state, &moore);
 
 			State_UncheckGamemode(state);
 			CheckMenuItem(
@@ -375,7 +412,7 @@ void State_HandleMenuEvent(State* state, HWND hwnd, WORD id){
 				.pszSpec = L"*.lua",
 			},
 		};
-		LPWSTR filePath = State_CreateFileDialog(state, filters, sizeof(filters)/sizeof(*filters), L"lua");
+		LPWSTR filePath = State_CreateFileDialog(state, filters, sizeof(filters)/sizeof(*filters), L"lua", false);
 
 		if(filePath != NULL){
 			int mbBufferSize = WideCharToMultiByte(
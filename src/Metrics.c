@@ -0,0 +1,151 @@
+#include "Metrics.h"
+#include "Histogram.h"
+#include "Constants.h"
+#include "Win.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+typedef struct MetricInfo {
+	const char* name;
+	const char* help;
+	// recorded values to the exported unit
+	double scale;
+} MetricInfo;
+
+static const MetricInfo METRIC_INFO[METRIC_COUNT] = {
+	{ "minesweeper_generation_seconds", "Time creating a board after the first click.", 1e-6 },
+	{ "minesweeper_solver_seconds", "Time the solver spent creating a board, summed over every thread solving candidates.", 1e-6 },
+	{ "minesweeper_generation_moves", "Mines moved by construction or repair to create a board.", 1.0 },
+	{ "minesweeper_generation_restarts", "Boards thrown away to create a board.", 1.0 },
+	{ "minesweeper_frame_seconds", "Time from one frame to the next.", 1e-6 },
+};
+
+static const double METRIC_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+typedef struct MetricsBoard {
+	int width, height, nMines;
+	bool custom;
+	Histogram histograms[METRIC_COUNT];
+} MetricsBoard;
+
+struct Metrics {
+	const char* path;
+	uint64_t lastWrite;
+
+	MetricsBoard boards[METRICS_MAX_BOARDS];
+	int nBoards;
+	// recorded for a board that didn't fit anymore
+	uint64_t nDropped;
+};
+
+Metrics* Metrics_New(const char* path){
+	Metrics* metrics = calloc(1, sizeof(*metrics));
+	metrics->path = path;
+	metrics->lastWrite = SDL_GetPerformanceCounter();
+	return metrics;
+}
+
+void Metrics_Free(Metrics* metrics){
+	free(metrics);
+}
+
+static MetricsBoard* Metrics_GetBoard(Metrics* metrics, int width, int height, int nMines, bool custom){
+	for(int i = 0; i < metrics->nBoards; ++i){
+		MetricsBoard* board = &metrics->boards[i];
+		if(board->width == width && board->height == height && board->nMines == nMines && board->custom == custom){
+			return board;
+		}
+	}
+
+	if(metrics->nBoards == METRICS_MAX_BOARDS) return NULL;
+
+	MetricsBoard* board = &metrics->boards[metrics->nBoards++];
+	board->width = width;
+	board->height = height;
+	board->nMines = nMines;
+	board->custom = custom;
+	return board;
+}
+
+void Metrics_Record(Metrics* metrics, Metric metric, int width, int height, int nMines, bool custom, uint64_t value){
+	MetricsBoard* board = Metrics_GetBoard(metrics, width, height, nMines, custom);
+	if(board == NULL){
+		++metrics->nDropped;
+		return;
+	}
+	Histogram_Record(&board->histograms[metric], value);
+}
+
+void Metrics_Poll(Metrics* metrics){
+	uint64_t now = SDL_GetPerformanceCounter();
+	if((now - metrics->lastWrite) * 1000 < METRICS_WRITE_INTERVAL_MS * SDL_GetPerformanceFrequency()) return;
+
+	Metrics_Write(metrics);
+}
+
+static void Metrics_WriteLabels(FILE* file, const MetricsBoard* board){
+	fprintf(
+		file,
+		"mode=\"%s\",board=\"%dx%d:%d\"",
+		board->custom ? "custom" : "default",
+		board->width, board->height, board->nMines
+	);
+}
+
+bool Metrics_Write(Metrics* metrics){
+	metrics->lastWrite = SDL_GetPerformanceCounter();
+
+	// scrapers must never see half a file, so it's written next to it and moved over it
+	char tempPath[MAX_PATH];
+	snprintf(tempPath, sizeof(tempPath), "%s.tmp", metrics->path);
+	FILE* file = fopen(tempPath, "w");
+	if(file == NULL){
+		fprintf(stderr, "Could not write metrics to \"%s\"\n", tempPath);
+		return false;
+	}
+
+	for(int metric = 0; metric < METRIC_COUNT; ++metric){
+		const MetricInfo* info = &METRIC_INFO[metric];
+		fprintf(file, "# HELP %s %s\n", info->name, info->help);
+		fprintf(file, "# TYPE %s summary\n", info->name);
+
+		for(int i = 0; i < metrics->nBoards; ++i){
+			const MetricsBoard* board = &metrics->boards[i];
+			const Histogram* histogram = &board->histograms[metric];
+			if(histogram->n == 0) continue;
+
+			for(size_t q = 0; q < sizeof(METRIC_QUANTILES) / sizeof(*METRIC_QUANTILES); ++q){
+				fprintf(file, "%s{", info->name);
+				Metrics_WriteLabels(file, board);
+				fprintf(
+					file,
+					",quantile=\"%g\"} %.9g\n",
+					METRIC_QUANTILES[q],
+					Histogram_Percentile(histogram, METRIC_QUANTILES[q]) * info->scale
+				);
+			}
+
+			fprintf(file, "%s_sum{", info->name);
+			Metrics_WriteLabels(file, board);
+			fprintf(file, "} %.9g\n", histogram->sum * info->scale);
+
+			fprintf(file, "%s_count{", info->name);
+			Metrics_WriteLabels(file, board);
+			fprintf(file, "} %llu\n", (unsigned long long) histogram->n);
+		}
+	}
+
+	fprintf(file, "# HELP minesweeper_metrics_dropped_total Values recorded after every board slot was taken.\n");
+	fprintf(file, "# TYPE minesweeper_metrics_dropped_total counter\n");
+	fprintf(file, "minesweeper_metrics_dropped_total %llu\n", (unsigned long long) metrics->nDropped);
+
+	bool written = !ferror(file);
+	written = fclose(file) == 0 && written;
+	if(written) written = MoveFileExA(tempPath, metrics->path, MOVEFILE_REPLACE_EXISTING);
+
+	if(!written) fprintf(stderr, "Could not write metrics to \"%s\"\n", metrics->path);
+	return written;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// latency histograms per board, written out in Prometheus' text format
+// for a textfile collector to pick up
+// the server (Server.h) doesn't serve them, its socket only speaks its own binary protocol
+
+typedef enum Metric {
+	// State_CreateGame, in us
+	METRIC_GENERATION,
+	// HasSolution while creating a board, in us, summed over band search threads
+	METRIC_SOLVER,
+	// mines construction or repair moved creating a board
+	METRIC_MOVES,
+	// boards thrown away creating a board
+	METRIC_RESTARTS,
+	// from one frame to the next, in us
+	METRIC_FRAME,
+	METRIC_COUNT,
+} Metric;
+
+typedef struct Metrics Metrics;
+
+// path is written over every METRICS_WRITE_INTERVAL_MS, it has to outlive the metrics
+Metrics* Metrics_New(const char* path);
+void Metrics_Free(Metrics*);
+
+// values are split by board and whether it's a custom game mode
+void Metrics_Record(Metrics*, Metric, int width, int height, int nMines, bool custom, uint64_t value);
+
+// writes the file if it's been long enough since the last time
+void Metrics_Poll(Metrics*);
+// returns false if the file couldn't be written
+bool Metrics_Write(Metrics*);
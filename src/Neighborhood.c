@@ -0,0 +1,166 @@
+#include "Neighborhood.h"
+
+#include "State.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void Neighborhood_Clear(Neighborhood* nh){
+	memset(nh, 0, sizeof(*nh));
+}
+
+bool Neighborhood_AddOffset(Neighborhood* nh, int dx, int dy, int weight){
+	if(nh->n == NEIGHBORHOOD_MAX_OFFSETS) return false;
+	if(dx == 0 && dy == 0) return false;
+	if(abs(dx) > NEIGHBORHOOD_MAX_REACH || abs(dy) > NEIGHBORHOOD_MAX_REACH) return false;
+	if(weight < 1 || Neighborhood_MaxCount(nh) + weight > NEIGHBORHOOD_MAX_COUNT) return false;
+
+	for(int i = 0; i < nh->n; ++i){
+		if(nh->dx[i] == dx && nh->dy[i] == dy) return false;
+	}
+
+	nh->dx[nh->n] = dx;
+	nh->dy[nh->n] = dy;
+	nh->weight[nh->n] = weight;
+	++nh->n;
+
+	nh->reachX = KET_MAX(nh->reachX, abs(dx));
+	nh->reachY = KET_MAX(nh->reachY, abs(dy));
+	return true;
+}
+
+void Neighborhood_InitMoore(Neighborhood* nh){
+	Neighborhood_InitPreset(nh, "moore");
+}
+
+bool Neighborhood_InitPreset(Neighborhood* nh, const char* name){
+	Neighborhood_Clear(nh);
+
+	if(strcmp(name, "moore") == 0){
+		for(int dy = -1; dy <= 1; ++dy){
+			for(int dx = -1; dx <= 1; ++dx){
+				if(dx != 0 || dy != 0) Neighborhood_AddOffset(nh, dx, dy, 1);
+			}
+		}
+		return true;
+	}
+	else if(strcmp(name, "cross") == 0){
+		Neighborhood_AddOffset(nh, 0, -1, 1);
+		Neighborhood_AddOffset(nh, -1, 0, 1);
+		Neighborhood_AddOffset(nh, 1, 0, 1);
+		Neighborhood_AddOffset(nh, 0, 1, 1);
+		return true;
+	}
+	else if(strcmp(name, "knight") == 0){
+		const int knight[8][2] = {
+			{ 1, -2 }, { 2, -1 }, { 2, 1 }, { 1, 2 },
+			{ -1, 2 }, { -2, 1 }, { -2, -1 }, { -1, -2 },
+		};
+		for(int i = 0; i < 8; ++i){
+			Neighborhood_AddOffset(nh, knight[i][0], knight[i][1], 1);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+int Neighborhood_MaxCount(const Neighborhood* nh){
+	int sum = 0;
+	for(int i = 0; i < nh->n; ++i){
+		sum += nh->weight[i];
+	}
+	return sum;
+}
+
+// the offset closest to 0 that lands where d does on a torus of the given size
+static int Neighborhood_Wrap(int d, int size){
+	d = ((d % size) + size) % size;
+	return d > size / 2 ? d - size : d;
+}
+
+void Neighborhood_Fit(Neighborhood* nh, const Neighborhood* rule, int w, int h){
+	if(!rule->wrap || w <= 0 || h <= 0 || (w > 2 * rule->reachX && h > 2 * rule->reachY)){
+		*nh = *rule;
+		return;
+	}
+
+	Neighborhood_Clear(nh);
+	nh->wrap = true;
+	for(int i = 0; i < rule->n; ++i){
+		int dx = Neighborhood_Wrap(rule->dx[i], w);
+		int dy = Neighborhood_Wrap(rule->dy[i], h);
+		if(dx == 0 && dy == 0) continue;
+
+		int j = 0;
+		while(j < nh->n && (nh->dx[j] != dx || nh->dy[j] != dy)) ++j;
+		if(j == nh->n){
+			nh->dx[j] = dx;
+			nh->dy[j] = dy;
+			++nh->n;
+		}
+		nh->weight[j] += rule->weight[i];
+
+		nh->reachX = KET_MAX(nh->reachX, abs(dx));
+		nh->reachY = KET_MAX(nh->reachY, abs(dy));
+	}
+}
+
+static bool Neighborhood_Offset(const Neighborhood* nh, int w, int h, int x, int y, int dx, int dy, int* nx, int* ny){
+	x += dx;
+	y += dy;
+	if(nh->wrap){
+		x = ((x % w) + w) % w;
+		y = ((y % h) + h) % h;
+	}
+	else if(x < 0 || x >= w || y < 0 || y >= h){
+		return false;
+	}
+	*nx = x;
+	*ny = y;
+	return true;
+}
+
+bool Neighborhood_Neighbor(const Neighborhood* nh, int w, int h, int x, int y, int i, int* nx, int* ny){
+	return Neighborhood_Offset(nh, w, h, x, y, nh->dx[i], nh->dy[i], nx, ny);
+}
+
+bool Neighborhood_Referrer(const Neighborhood* nh, int w, int h, int x, int y, int i, int* nx, int* ny){
+	return Neighborhood_Offset(nh, w, h, x, y, -nh->dx[i], -nh->dy[i], nx, ny);
+}
+
+void Neighborhood_CountMines(const Neighborhood* nh, Tile* tiles, int w, int h){
+	// in the interior, neighbors are a fixed distance away in the tile array
+	int linearOffsets[NEIGHBORHOOD_MAX_OFFSETS];
+	for(int i = 0; i < nh->n; ++i){
+		linearOffsets[i] = nh->dx[i] + nh->dy[i] * w;
+	}
+
+	for(int y = 0; y < h; ++y){
+		bool interiorRow = y >= nh->reachY && y < h - nh->reachY;
+
+		for(int x = 0; x < w; ++x){
+			int index = x + y * w;
+			int count = 0;
+
+			if(interiorRow && x >= nh->reachX && x < w - nh->reachX){
+				const Tile* tile = &tiles[index];
+				for(int i = 0; i < nh->n; ++i){
+					count += ((tile[linearOffsets[i]].state & TILE_STATE_MINE) != 0) * nh->weight[i];
+				}
+			}
+			else {
+				for(int i = 0; i < nh->n; ++i){
+					int nx, ny;
+					if(!Neighborhood_Neighbor(nh, w, h, x, y, i, &nx, &ny)) continue;
+					if(tiles[nx + ny * w].state & TILE_STATE_MINE){
+						count += nh->weight[i];
+					}
+				}
+			}
+
+			tiles[index].surroundingMines = count;
+			tiles[index].state |= TILE_STATE_INITIALIZED;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "Constants.h"
+
+struct Tile;
+
+// which tiles a number counts, and how much each mine is worth
+// compiled from a rule description once, then used by every counting loop
+typedef struct Neighborhood {
+	int n;
+	int dx[NEIGHBORHOOD_MAX_OFFSETS];
+	int dy[NEIGHBORHOOD_MAX_OFFSETS];
+	int weight[NEIGHBORHOOD_MAX_OFFSETS];
+
+	// board is a torus
+	bool wrap;
+
+	// largest |dx| and |dy|
+	// tiles at least this far from the edge never need bounds checks
+	int reachX, reachY;
+} Neighborhood;
+
+// standard 3x3 neighborhood, every mine worth 1
+void Neighborhood_InitMoore(Neighborhood*);
+
+// knight, cross, moore
+bool Neighborhood_InitPreset(Neighborhood*, const char* name);
+
+void Neighborhood_Clear(Neighborhood*);
+
+// returns false if the offset is invalid, duplicated, or there are too many
+bool Neighborhood_AddOffset(Neighborhood*, int dx, int dy, int weight);
+
+// sum of all weights, ie: the largest number a tile can show
+int Neighborhood_MaxCount(const Neighborhood*);
+
+// the rule as it plays out on a w x h board, what every counting loop uses
+// a torus narrower or shorter than 2 * reach + 1 would have several offsets land on
+// the same tile, or on the tile itself: those become one offset with their weights
+// added up, and the tile itself is never counted
+void Neighborhood_Fit(Neighborhood*, const Neighborhood* rule, int w, int h);
+
+// position of the ith tile counted by (x, y)
+// returns false if it's off the board
+bool Neighborhood_Neighbor(const Neighborhood*, int w, int h, int x, int y, int i, int* nx, int* ny);
+
+// position of the ith tile whose number counts (x, y)
+// same as Neighborhood_Neighbor for symmetric neighborhoods
+bool Neighborhood_Referrer(const Neighborhood*, int w, int h, int x, int y, int i, int* nx, int* ny);
+
+// sets surroundingMines and TILE_STATE_INITIALIZED for every tile
+void Neighborhood_CountMines(const Neighborhood*, struct Tile* tiles, int w, int h);
@@ -0,0 +1,71 @@
+#include "Patterns.h"
+#include "Constants.h"
+
+#include <SDL.h>
+
+#include <stdbool.h>
+
+#define PATTERN_SIDE (PATTERN_MAX_TILES + 1)
+
+static uint8_t patternTable[PATTERN_SIDE * PATTERN_SIDE * PATTERN_SIDE * PATTERN_SIDE * PATTERN_SIDE];
+static SDL_atomic_t patternTableReady;
+static SDL_SpinLock patternTableLock;
+
+static int Patterns_Index(int nFirst, int nShared, int nSecond, int missingFirst, int missingSecond){
+	return (((nFirst * PATTERN_SIDE + nShared) * PATTERN_SIDE + nSecond) * PATTERN_SIDE + missingFirst) * PATTERN_SIDE + missingSecond;
+}
+
+// tries every number of mines among the shared tiles,
+// anything true for all that fit both numbers is proven
+static uint8_t Patterns_Solve(int nFirst, int nShared, int nSecond, int missingFirst, int missingSecond){
+	int minFirst = PATTERN_SIDE, maxFirst = -1;
+	int minShared = PATTERN_SIDE, maxShared = -1;
+	int minSecond = PATTERN_SIDE, maxSecond = -1;
+
+	for(int shared = 0; shared <= nShared; ++shared){
+		int first = missingFirst - shared, second = missingSecond - shared;
+		if(first < 0 || first > nFirst || second < 0 || second > nSecond) continue;
+
+		minFirst = KET_MIN(minFirst, first);
+		maxFirst = KET_MAX(maxFirst, first);
+		minShared = KET_MIN(minShared, shared);
+		maxShared = KET_MAX(maxShared, shared);
+		minSecond = KET_MIN(minSecond, second);
+		maxSecond = KET_MAX(maxSecond, second);
+	}
+	// contradiction, can't happen on a real board
+	if(maxShared == -1) return 0;
+
+	uint8_t result = 0;
+	if(nFirst > 0 && maxFirst == 0) result |= PATTERN_FIRST_SAFE;
+	if(nFirst > 0 && minFirst == nFirst) result |= PATTERN_FIRST_MINES;
+	if(nShared > 0 && maxShared == 0) result |= PATTERN_SHARED_SAFE;
+	if(nShared > 0 && minShared == nShared) result |= PATTERN_SHARED_MINES;
+	if(nSecond > 0 && maxSecond == 0) result |= PATTERN_SECOND_SAFE;
+	if(nSecond > 0 && minSecond == nSecond) result |= PATTERN_SECOND_MINES;
+	return result;
+}
+
+static void Patterns_Init(void){
+	for(int nFirst = 0; nFirst < PATTERN_SIDE; ++nFirst)
+	for(int nShared = 0; nShared < PATTERN_SIDE; ++nShared)
+	for(int nSecond = 0; nSecond < PATTERN_SIDE; ++nSecond)
+	for(int missingFirst = 0; missingFirst < PATTERN_SIDE; ++missingFirst)
+	for(int missingSecond = 0; missingSecond < PATTERN_SIDE; ++missingSecond){
+		patternTable[Patterns_Index(nFirst, nShared, nSecond, missingFirst, missingSecond)] =
+			Patterns_Solve(nFirst, nShared, nSecond, missingFirst, missingSecond);
+	}
+}
+
+uint8_t Patterns_Lookup(int nFirst, int nShared, int nSecond, int missingFirst, int missingSecond){
+	if(!SDL_AtomicGet(&patternTableReady)){
+		SDL_AtomicLock(&patternTableLock);
+		if(!SDL_AtomicGet(&patternTableReady)){
+			Patterns_Init();
+			SDL_AtomicSet(&patternTableReady, 1);
+		}
+		SDL_AtomicUnlock(&patternTableLock);
+	}
+
+	return patternTable[Patterns_Index(nFirst, nShared, nSecond, missingFirst, missingSecond)];
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+// what two overlapping numbers prove together, eg: 1-1 and 1-2 along an edge
+// their covered tiles split into the ones only the first counts, shared ones, and ones only the second counts
+// every mine weighs 1, numbers count at most PATTERN_MAX_TILES covered tiles
+
+typedef enum PatternResult {
+	PATTERN_FIRST_SAFE = 1 << 0,
+	PATTERN_FIRST_MINES = 1 << 1,
+	PATTERN_SHARED_SAFE = 1 << 2,
+	PATTERN_SHARED_MINES = 1 << 3,
+	PATTERN_SECOND_SAFE = 1 << 4,
+	PATTERN_SECOND_MINES = 1 << 5,
+} PatternResult;
+
+// nFirst, nShared, nSecond: covered tiles in each part
+// missingFirst, missingSecond: mines each number still needs
+// returns a mask of PatternResult, 0 if nothing follows
+// the table is filled on first use, safe from any thread
+uint8_t Patterns_Lookup(int nFirst, int nShared, int nSecond, int missingFirst, int missingSecond);
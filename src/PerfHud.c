@@ -0,0 +1,158 @@
+#include "PerfHud.h"
+#include "State.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+// rows of the HUD, each labeled with the tile number sprite of its row
+// 1: frame time in us: last frame, p50, p99
+// 2: draw calls and tiles drawn last frame
+// 3: creating the last board in us: total, then each GenerationPhase
+// 4: SolveIter calls creating the last board
+// 5: clicks to present in us: p50, p99, max
+// below them, a histogram of frame times in 1 ms buckets
+#define PERF_HUD_N_ROWS 5
+#define PERF_HUD_MAX_VALUES (GENERATION_PHASE_COUNT + 1)
+
+void PerfHud_BeginFrame(PerfHud* hud){
+	uint64_t now = SDL_GetPerformanceCounter();
+	if(hud->lastFrameStart != 0){
+		uint64_t us = (now - hud->lastFrameStart) * 1000000 / SDL_GetPerformanceFrequency();
+		hud->frameTimes[hud->nFrames % PERF_HUD_N_FRAMES] = (uint32_t) KET_MIN(us, UINT32_MAX);
+		++hud->nFrames;
+	}
+	hud->lastFrameStart = now;
+}
+
+void PerfHud_EndFrame(PerfHud* hud){
+	hud->lastDrawCalls = hud->nDrawCalls;
+	hud->lastTilesDrawn = hud->nTilesDrawn;
+	hud->nDrawCalls = 0;
+	hud->nTilesDrawn = 0;
+}
+
+void PerfHud_RecordPhase(PerfHud* hud, GenerationPhase phase, uint64_t start){
+	uint64_t us = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+	hud->generationPhases[phase] = (uint32_t) KET_MIN(us, UINT32_MAX);
+}
+
+static int CompareFrameTimes(const void* a, const void* b){
+	uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+	return (x > y) - (x < y);
+}
+
+static int CountDigits(uint64_t value){
+	int nDigits = 1;
+	while(value >= 10){
+		value /= 10;
+		++nDigits;
+	}
+	return nDigits;
+}
+
+// returns where the next number goes
+static float PerfHud_DrawNumber(State* state, uint64_t value, float x, float y, float digitW, float digitH){
+	int nDigits = CountDigits(value);
+	SDL_FRect rect = {
+		.x = x + (nDigits - 1) * digitW,
+		.y = y,
+		.w = digitW,
+		.h = digitH,
+	};
+	for(int i = 0; i < nDigits; ++i){
+		State_RenderSprite(state, &state->images.tilesheet.digit[value % 10], &rect);
+		value /= 10;
+		rect.x -= digitW;
+	}
+	return x + (nDigits + 1) * digitW;
+}
+
+static void PerfHud_FillRect(State* state, float x, float y, float w, float h){
+	SDL_FRect rect = { x, y, w, h };
+	SDL_RenderFillRectF(state->sdl.renderer, &rect);
+	++state->perfHud.nDrawCalls;
+}
+
+void State_DrawPerfHud(State* state){
+	PerfHud* hud = &state->perfHud;
+	if(!hud->visible) return;
+
+	int nFrames = (int) KET_MIN(hud->nFrames, PERF_HUD_N_FRAMES);
+	memcpy(hud->sortedFrameTimes, hud->frameTimes, nFrames * sizeof(*hud->sortedFrameTimes));
+	qsort(hud->sortedFrameTimes, nFrames, sizeof(*hud->sortedFrameTimes), CompareFrameTimes);
+
+	uint64_t values[PERF_HUD_N_ROWS][PERF_HUD_MAX_VALUES] = { 0 };
+	int nValues[PERF_HUD_N_ROWS] = { 3, 2, PERF_HUD_MAX_VALUES, 1, 3 };
+	if(nFrames > 0){
+		values[0][0] = hud->frameTimes[(hud->nFrames - 1) % PERF_HUD_N_FRAMES];
+		values[0][1] = hud->sortedFrameTimes[(nFrames - 1) * 50 / 100];
+		values[0][2] = hud->sortedFrameTimes[(nFrames - 1) * 99 / 100];
+	}
+	values[1][0] = hud->lastDrawCalls;
+	values[1][1] = hud->lastTilesDrawn;
+	for(int i = 0; i < GENERATION_PHASE_COUNT; ++i){
+		values[2][0] += hud->generationPhases[i];
+		values[2][i + 1] = hud->generationPhases[i];
+	}
+	values[3][0] = hud->generationIters;
+	Histogram* clicks = &state->latency.histograms[INPUT_KIND_BUTTON];
+	values[4][0] = Histogram_Percentile(clicks, 0.5);
+	values[4][1] = Histogram_Percentile(clicks, 0.99);
+	values[4][2] = clicks->max;
+
+	int buckets[PERF_HUD_N_BUCKETS] = { 0 };
+	int maxBucket = 1;
+	for(int i = 0; i < nFrames; ++i){
+		int bucket = KET_MIN(hud->frameTimes[i] / 1000, PERF_HUD_N_BUCKETS - 1);
+		maxBucket = KET_MAX(maxBucket, ++buckets[bucket]);
+	}
+
+	// scaled from the counters' digits, so the HUD grows with the window too
+	float digitW = state->layoutv2.time.w / 3.0f * PERF_HUD_DIGIT_SCALE;
+	float digitH = state->layoutv2.time.h * PERF_HUD_DIGIT_SCALE;
+	float padding = digitW / 2.0f;
+	float barW = digitW / 2.0f;
+	float histogramH = digitH * 2.0f;
+
+	float panelW = barW * PERF_HUD_N_BUCKETS;
+	for(int row = 0; row < PERF_HUD_N_ROWS; ++row){
+		// label, then numbers a digit apart
+		float rowW = digitH + padding - digitW;
+		for(int i = 0; i < nValues[row]; ++i){
+			rowW += (CountDigits(values[row][i]) + 1) * digitW;
+		}
+		panelW = KET_MAX(panelW, rowW);
+	}
+	float panelH = PERF_HUD_N_ROWS * (digitH + padding) + histogramH;
+
+	SDL_SetRenderDrawBlendMode(state->sdl.renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(state->sdl.renderer, 0, 0, 0, 192);
+	PerfHud_FillRect(state, 0, 0, panelW + padding * 2, panelH + padding * 2);
+
+	float y = padding;
+	for(int row = 0; row < PERF_HUD_N_ROWS; ++row){
+		SDL_FRect label = { padding, y, digitH, digitH };
+		State_RenderSprite(state, &state->images.tilesheet.tileDigit[row], &label);
+
+		float x = padding + digitH + padding;
+		for(int i = 0; i < nValues[row]; ++i){
+			x = PerfHud_DrawNumber(state, values[row][i], x, y, digitW, digitH);
+		}
+		y += digitH + padding;
+	}
+
+	// frames slower than 60 fps are red
+	for(int i = 0; i < PERF_HUD_N_BUCKETS; ++i){
+		if(buckets[i] == 0) continue;
+
+		if(i < 17) SDL_SetRenderDrawColor(state->sdl.renderer, 255, 255, 255, 255);
+		else SDL_SetRenderDrawColor(state->sdl.renderer, 255, 64, 64, 255);
+
+		float barH = histogramH * buckets[i] / maxBucket;
+		PerfHud_FillRect(state, padding + i * barW, y + histogramH - barH, barW - 1.0f, barH);
+	}
+
+	SDL_SetRenderDrawBlendMode(state->sdl.renderer, SDL_BLENDMODE_NONE);
+}
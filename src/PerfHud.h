@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct State;
+
+// where the time creating the last board went
+typedef enum GenerationPhase {
+	// sampling candidates for a difficulty band
+	GENERATION_PHASE_BAND,
+	// building the board while solving it
+	GENERATION_PHASE_CONSTRUCT,
+	// random boards repaired until solvable, if construction failed
+	GENERATION_PHASE_REPAIR,
+	// create_game of a custom game mode
+	GENERATION_PHASE_LUA,
+	// 3BV, openings and islands
+	GENERATION_PHASE_SCORE,
+	GENERATION_PHASE_COUNT,
+} GenerationPhase;
+
+// overlay toggled with F3, see State_DrawPerfHud
+// everything lives in here, so recording and drawing never allocate
+typedef struct PerfHud {
+	bool visible;
+
+	// counter as the last frame started, 0 before the first one
+	uint64_t lastFrameStart;
+	// in us, the last PERF_HUD_N_FRAMES frames
+	uint32_t frameTimes[PERF_HUD_N_FRAMES];
+	uint64_t nFrames;
+	// frameTimes sorted for percentiles
+	uint32_t sortedFrameTimes[PERF_HUD_N_FRAMES];
+
+	// counted during the frame, then kept as last* once it's presented
+	int nDrawCalls;
+	int nTilesDrawn;
+	int lastDrawCalls;
+	int lastTilesDrawn;
+
+	// of the last board created, in us
+	uint32_t generationPhases[GENERATION_PHASE_COUNT];
+	// SolveIter calls creating the last board
+	uint64_t generationIters;
+} PerfHud;
+
+// frame times are measured from one call to the next
+void PerfHud_BeginFrame(PerfHud*);
+void PerfHud_EndFrame(PerfHud*);
+
+// time since start, a counter from SDL_GetPerformanceCounter
+void PerfHud_RecordPhase(PerfHud*, GenerationPhase, uint64_t start);
+
+// draws on top of whatever State_Update drew, if the HUD is visible
+void State_DrawPerfHud(struct State*);
@@ -0,0 +1,30 @@
+#include "Random.h"
+
+void Random_Seed(Random* random, uint64_t seed){
+	// splitmix64 step, so that nearby seeds give unrelated sequences
+	// and a zero seed doesn't get the generator stuck
+	uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z ^= z >> 31;
+
+	random->state = z != 0 ? z : 1;
+}
+
+uint32_t Random_Next(Random* random){
+	uint64_t x = random->state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	random->state = x;
+	return (uint32_t)((x * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+float Random_Float(Random* random){
+	// 24 bits is all a float can hold without rounding up to 1
+	return (Random_Next(random) >> 8) * (1.0f / 16777216.0f);
+}
+
+int Random_Below(Random* random, int n){
+	return (int)(((uint64_t) Random_Next(random) * (uint64_t) n) >> 32);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// small deterministic generator (xorshift64*)
+// boards are generated from one of these so a seed reproduces a board exactly,
+// independently of the C runtime's rand
+typedef struct Random {
+	uint64_t state;
+} Random;
+
+void Random_Seed(Random*, uint64_t seed);
+
+uint32_t Random_Next(Random*);
+
+// uniform in [0, 1)
+float Random_Float(Random*);
+
+// uniform in [0, n)
+int Random_Below(Random*, int n);
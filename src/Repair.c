@@ -0,0 +1,274 @@
+#include "Repair.h"
+#include "Construct.h"
+#include "SolverCache.h"
+#include "State.h"
+#include "Solver.h"
+#include "Constants.h"
+#include "Trace.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// same area State_GenerateMinesDefault keeps clear
+static bool InSafeArea(int x, int y, int tileX, int tileY){
+	return x > tileX - BOARD_CLICK_SAFE_AREA && x < tileX + BOARD_CLICK_SAFE_AREA
+		&& y > tileY - BOARD_CLICK_SAFE_AREA && y < tileY + BOARD_CLICK_SAFE_AREA;
+}
+
+// tileX is -1 to resume without clicking
+static bool Repair_Solve(SolveState* solveState, int tileX, int tileY, int maxIters){
+	SolveParams solveParams = {
+		.state = solveState,
+		.tileClicked = { tileX, tileY },
+		.maxIters = maxIters,
+	};
+
+	TilePosition* unsolvableTiles;
+	size_t nUnsolvableTiles;
+	bool solved = HasSolution(&solveParams, &unsolvableTiles, &nUnsolvableTiles);
+	return solved;
+}
+
+// moves a mine and fixes every number counting either tile, the solver reads them from the board
+static void Repair_MoveMine(State* state, int from, int to){
+	int w = state->board.width, h = state->board.height;
+	Tile* tiles = state->board.tiles;
+	const Neighborhood* nh = &state->game.neighborhood;
+
+	tiles[from].state &= ~TILE_STATE_MINE;
+	tiles[to].state |= TILE_STATE_MINE;
+
+	for(int i = 0; i < nh->n; ++i){
+		int x, y;
+		if(Neighborhood_Referrer(nh, w, h, from % w, from / w, i, &x, &y)){
+			tiles[x + y * w].surroundingMines -= nh->weight[i];
+		}
+		if(Neighborhood_Referrer(nh, w, h, to % w, to / w, i, &x, &y)){
+			tiles[x + y * w].surroundingMines += nh->weight[i];
+		}
+	}
+}
+
+// earliest step that uncovered a number counting index, INT_MAX if none did
+static int Repair_FirstStepCounting(SolveState* solveState, int index){
+	const Neighborhood* nh = solveState->neighborhood;
+	int first = INT_MAX;
+	for(int i = 0; i < nh->n; ++i){
+		int x, y;
+		if(!Neighborhood_Referrer(nh, solveState->w, solveState->h, index % solveState->w, index / solveState->w, i, &x, &y)) continue;
+
+		int counting = x + y * solveState->w;
+		if(SolveState_Uncovered(solveState, counting)) first = KET_MIN(first, solveState->steps[counting]);
+	}
+	return first;
+}
+
+// whether index is next to a covered tile that isn't flagged
+static bool Repair_BordersCovered(SolveState* solveState, int index){
+	const Neighborhood* nh = solveState->neighborhood;
+	int w = solveState->w, h = solveState->h;
+	for(int i = 0; i < nh->n; ++i){
+		int x, y;
+		if(!Neighborhood_Neighbor(nh, w, h, index % w, index / w, i, &x, &y)) continue;
+
+		if(!SolveState_Uncovered(solveState, x + y * w) && !SolveState_Flagged(solveState, x + y * w)) return true;
+	}
+	return false;
+}
+
+int Repair_ChooseMove(State* state, SolveState* solveState, int tileX, int tileY, const bool* targets, int* fromOut, int* toOut){
+	int w = state->board.width, h = state->board.height;
+
+	// the failed constraints are the numbers with mines missing,
+	// so move one of the covered mines they count: the solver had no way to place it
+	// it goes wherever the fewest deductions are undone: ideally somewhere no uncovered number counts,
+	// but near the end of a board there's often nowhere like that left
+	// if every mine next to the uncovered tiles is flagged, the rest is walled off by flags,
+	// so a flag bordering it moves instead
+	int from = -1, nFrom = 0;
+	int wall = -1, nWall = 0;
+	int to = -1, nTo = 0, toChanged = -1;
+	for(int y = 0; y < h; ++y){
+		for(int x = 0; x < w; ++x){
+			int index = x + y * w;
+			bool mine = state->board.tiles[index].state & TILE_STATE_MINE;
+
+			if(SolveState_Flagged(solveState, index)){
+				if(mine && Repair_BordersCovered(solveState, index) && Random_Below(&state->game.random, ++nWall) == 0){
+					wall = index;
+				}
+				continue;
+			}
+
+			int changed = Repair_FirstStepCounting(solveState, index);
+			if(mine){
+				if(!SolveState_Uncovered(solveState, index) && changed != INT_MAX && Random_Below(&state->game.random, ++nFrom) == 0){
+					from = index;
+				}
+				continue;
+			}
+
+			if(InSafeArea(x, y, tileX, tileY) || (targets != NULL && !targets[index])) continue;
+			if(SolveState_Uncovered(solveState, index)) changed = KET_MIN(changed, solveState->steps[index]);
+
+			if(changed > toChanged){
+				toChanged = changed;
+				to = index;
+				nTo = 1;
+			}
+			else if(changed == toChanged && Random_Below(&state->game.random, ++nTo) == 0){
+				to = index;
+			}
+		}
+	}
+	if(from == -1) from = wall;
+	if(from == -1 || to == -1) return -1;
+
+	*fromOut = from;
+	*toOut = to;
+	int firstChanged = KET_MIN(Repair_FirstStepCounting(solveState, from), toChanged);
+	// the flag itself has to go too
+	if(SolveState_Flagged(solveState, from)) firstChanged = KET_MIN(firstChanged, solveState->steps[from]);
+	return firstChanged;
+}
+
+bool State_RepairBoard(State* state, int tileX, int tileY, int maxRepairs, SolveTechnique* hardest){
+	TRACE_BEGIN("State_RepairBoard");
+
+	SolveState* solveState = state->game.solveState;
+	SolveState_Reset(solveState, state);
+	int maxIters = state->board.nMines / 2;
+
+	bool solved = Repair_Solve(solveState, tileX, tileY, maxIters);
+
+	int repair = 0;
+	for(; !solved && repair < maxRepairs; ++repair){
+		int from, to;
+		int firstChanged = Repair_ChooseMove(state, solveState, tileX, tileY, NULL, &from, &to);
+		if(firstChanged == -1) break;
+
+		Repair_MoveMine(state, from, to);
+
+		// deductions up to the step before the first changed number still hold
+		RollbackSolveState(solveState, firstChanged - 1);
+		if(firstChanged == 0){
+			// the first click itself is undone
+			solved = Repair_Solve(solveState, tileX, tileY, maxIters);
+		}
+		else{
+			solved = Repair_Solve(solveState, -1, -1, maxIters);
+		}
+	}
+
+	if(hardest != NULL) *hardest = solveState->hardest;
+	state->board.nGeneratorMoves += repair;
+
+	TRACE_ARG("repairs", repair);
+	TRACE_ARG("solved", solved);
+	TRACE_END();
+	return solved;
+}
+
+int State_GenerateSolvableBoard(State* state, int tileX, int tileY, int maxRepairs){
+	TRACE_BEGIN("State_GenerateSolvableBoard");
+
+	State_GenerateMinesDefault(state, tileX, tileY);
+	State_GenerateFlagsDefault(state);
+	int nBoards = 1;
+
+	while(!State_RepairBoard(state, tileX, tileY, maxRepairs, &state->board.score.technique)){
+		State_ClearBoard(state);
+		if(nBoards == GENERATOR_MAX_BOARDS){
+			nBoards = 0;
+			break;
+		}
+
+		State_GenerateMinesDefault(state, tileX, tileY);
+		State_GenerateFlagsDefault(state);
+		++nBoards;
+	}
+
+	state->board.nGeneratorRestarts += (nBoards > 0 ? nBoards : GENERATOR_MAX_BOARDS) - 1;
+	TRACE_ARG("boards", nBoards);
+	TRACE_END();
+	return nBoards;
+}
+
+bool Repair_CanGenerate(int width, int height, int nMines){
+	// State_GenerateMinesDefault counts a square one tile wider than the safe area as taken,
+	// any more mines than the rest of the board holds and the last ones aren't placed
+	int taken = (BOARD_CLICK_SAFE_AREA * 2 + 1) * (BOARD_CLICK_SAFE_AREA * 2 + 1);
+	return width > 0 && height > 0 && nMines >= 0 && nMines <= width * height - taken;
+}
+
+void Repair_Bench(int nBoards, int width, int height, int nMines){
+	if(!Repair_CanGenerate(width, height, nMines)){
+		fprintf(stderr, "Invalid board %dx%d with %d mines\n", width, height, nMines);
+		return;
+	}
+
+	State state;
+	State_InitHeadless(&state);
+	state.board.width = width;
+	state.board.height = height;
+	state.board.nMines = nMines;
+	State_ResetBoard(&state);
+
+	double frequency = (double) SDL_GetPerformanceFrequency();
+	const char* modeNames[] = { "restart", "repair", "construct" };
+	double msPerBoard[3];
+
+	printf("Generating %d solvable %dx%d boards with %d mines\n", nBoards, width, height, nMines);
+	for(int mode = 0; mode < 3; ++mode){
+		int maxRepairs = mode == 0 ? 0 : GENERATOR_MAX_REPAIRS;
+
+		uint64_t counter = 0, slowest = 0;
+		uint64_t nGenerated = 0;
+		int nGaveUp = 0;
+		uint64_t nHitsBefore, nMissesBefore;
+		SolverCache_GetStats(state.game.solverCache, &nHitsBefore, &nMissesBefore);
+		for(int i = 0; i < nBoards; ++i){
+			// every mode starts from the same seeds
+			State_ClearBoard(&state);
+			Random_Seed(&state.game.random, i);
+
+			uint64_t start = SDL_GetPerformanceCounter();
+			if(mode == 2 && State_ConstructBoard(&state, width / 2, height / 2, GENERATOR_MAX_MOVES, NULL)){
+				++nGenerated;
+			}
+			else{
+				int n = State_GenerateSolvableBoard(&state, width / 2, height / 2, maxRepairs);
+				nGenerated += n > 0 ? n : GENERATOR_MAX_BOARDS;
+				nGaveUp += n == 0;
+			}
+			uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+			counter += elapsed;
+			slowest = KET_MAX(slowest, elapsed);
+		}
+
+		uint64_t nHits, nMisses;
+		SolverCache_GetStats(state.game.solverCache, &nHits, &nMisses);
+		nHits -= nHitsBefore;
+		nMisses -= nMissesBefore;
+
+		msPerBoard[mode] = counter * 1000.0 / frequency / nBoards;
+		printf(
+			"\t%s: %.3f ms per board, %.3f ms at worst, %.2f boards generated per solvable one, %.1f%% of frontier parts cached\n",
+			modeNames[mode],
+			msPerBoard[mode],
+			slowest * 1000.0 / frequency,
+			(double) nGenerated / nBoards,
+			nHits + nMisses > 0 ? nHits * 100.0 / (nHits + nMisses) : 0.0
+		);
+		if(nGaveUp > 0) printf("\t\t%d gave up after %d boards\n", nGaveUp, GENERATOR_MAX_BOARDS);
+	}
+	printf(
+		"\trepair is %.2fx faster than restarting, construction %.2fx\n",
+		msPerBoard[0] / msPerBoard[1],
+		msPerBoard[0] / msPerBoard[2]
+	);
+	printf("\tsolver temporaries peaked at %zu bytes per iteration\n", state.game.solveState->arena.highWater);
+
+	State_Destroy(&state);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "Difficulty.h"
+
+struct State;
+struct SolveState;
+
+// makes a counted board solvable from the first click by moving mines the solver got stuck on
+// to tiles far from everything it uncovered, up to maxRepairs times
+// after each move, solving resumes from the last step whose numbers didn't change
+// hardest may be NULL, it can overestimate if moves undid harder deductions
+bool State_RepairBoard(struct State*, int tileX, int tileY, int maxRepairs, SolveTechnique* hardest);
+
+// picks a covered mine the solver got stuck on, and the tile where moving it undoes the fewest deductions
+// targets limits where it may go, NULL for anywhere outside the safe area
+// returns the first solver step the move changes, -1 if there's no move left
+int Repair_ChooseMove(struct State*, struct SolveState*, int tileX, int tileY, const bool* targets, int* from, int* to);
+
+// generates default boards until one can be made solvable with at most maxRepairs moves
+// returns how many boards were generated, 0 if none of GENERATOR_MAX_BOARDS could be, leaving the board cleared
+int State_GenerateSolvableBoard(struct State*, int tileX, int tileY, int maxRepairs);
+
+// whether State_GenerateMinesDefault places every one of nMines wherever the first click is,
+// anything asking for boards from outside the game checks this first
+bool Repair_CanGenerate(int width, int height, int nMines);
+
+// times generating solvable boards by restarting, by repairing, and by construction
+void Repair_Bench(int nBoards, int width, int height, int nMines);
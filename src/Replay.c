@@ -0,0 +1,462 @@
+#include "Replay.h"
+#include "State.h"
+#include "History.h"
+#include "Constants.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// file layout, every integer is a LEB128 varint, signed ones are zigzag encoded:
+//	header: magic (4 bytes), version, board width, height, mines, layout width, height
+//	records: type (1 byte), us since the previous record, payload
+// mouse positions are stored relative to the previous one,
+// so a typical motion record is 3 or 4 bytes
+
+typedef enum ReplayRecordType {
+	REPLAY_RECORD_MOUSE_DOWN,	// button, dx, dy
+	REPLAY_RECORD_MOUSE_UP,		// button, dx, dy
+	REPLAY_RECORD_MOUSE_MOTION,	// dx, dy
+	REPLAY_RECORD_RESIZE,		// width, height
+	REPLAY_RECORD_BOARD,		// width, height, mines
+	REPLAY_RECORD_GAME_START,	// seed, tile x, tile y, difficulty band: enabled, min and max 3BV, min and max technique
+	REPLAY_RECORD_KEY_DOWN,		// key, modifiers
+	REPLAY_RECORD_COUNT,
+} ReplayRecordType;
+
+static const char* REPLAY_RECORD_NAMES[REPLAY_RECORD_COUNT] = {
+	"mouse down",
+	"mouse up",
+	"mouse motion",
+	"resize",
+	"board",
+	"game start",
+	"key down",
+};
+
+typedef struct Recorder {
+	FILE* file;
+	// performance counter at the last record
+	uint64_t lastCounter;
+	int mouseX, mouseY;
+} Recorder;
+
+static void WriteVarint(FILE* file, uint64_t value){
+	while(value >= 0x80){
+		fputc((int)(value & 0x7F) | 0x80, file);
+		value >>= 7;
+	}
+	fputc((int) value, file);
+}
+
+static void WriteSigned(FILE* file, int64_t value){
+	WriteVarint(file, ((uint64_t) value << 1) ^ (uint64_t)(value >> 63));
+}
+
+// NULL if events shouldn't be recorded right now
+static Recorder* State_GetRecorder(State* state){
+	if(state->recorder == NULL || state->game.mode != GAMEMODE_DEFAULT) return NULL;
+	return state->recorder;
+}
+
+static void Recorder_BeginRecord(Recorder* recorder, ReplayRecordType type){
+	uint64_t counter = SDL_GetPerformanceCounter();
+	fputc(type, recorder->file);
+	WriteVarint(recorder->file, (counter - recorder->lastCounter) * 1000000 / SDL_GetPerformanceFrequency());
+	recorder->lastCounter = counter;
+}
+
+static void Recorder_WriteMouse(Recorder* recorder, int x, int y){
+	WriteSigned(recorder->file, x - recorder->mouseX);
+	WriteSigned(recorder->file, y - recorder->mouseY);
+	recorder->mouseX = x;
+	recorder->mouseY = y;
+}
+
+bool State_StartRecording(State* state, const char* path){
+	State_StopRecording(state);
+
+	FILE* file = fopen(path, "wb");
+	if(file == NULL){
+		fprintf(stderr, "Could not open \"%s\" for recording\n", path);
+		return false;
+	}
+
+	Recorder* recorder = calloc(1, sizeof(*recorder));
+	recorder->file = file;
+	recorder->lastCounter = SDL_GetPerformanceCounter();
+
+	for(int i = 0; i < 4; ++i){
+		fputc((REPLAY_MAGIC >> (i * 8)) & 0xFF, file);
+	}
+	WriteVarint(file, REPLAY_VERSION);
+	WriteVarint(file, state->board.width);
+	WriteVarint(file, state->board.height);
+	WriteVarint(file, state->board.nMines);
+	WriteVarint(file, state->layoutSize.width);
+	WriteVarint(file, state->layoutSize.height);
+
+	state->recorder = recorder;
+	return true;
+}
+
+void State_StopRecording(State* state){
+	Recorder* recorder = state->recorder;
+	if(recorder == NULL) return;
+
+	fclose(recorder->file);
+	free(recorder);
+	state->recorder = NULL;
+}
+
+void State_RecordEvent(State* state, const SDL_Event* event){
+	Recorder* recorder = State_GetRecorder(state);
+	if(recorder == NULL) return;
+
+	switch(event->type){
+		case SDL_WINDOWEVENT: {
+			if(event->window.event == SDL_WINDOWEVENT_RESIZED){
+				Recorder_BeginRecord(recorder, REPLAY_RECORD_RESIZE);
+				WriteVarint(recorder->file, event->window.data1);
+				WriteVarint(recorder->file, event->window.data2);
+			}
+			break;
+		}
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP: {
+			Recorder_BeginRecord(
+				recorder,
+				event->type == SDL_MOUSEBUTTONDOWN ? REPLAY_RECORD_MOUSE_DOWN : REPLAY_RECORD_MOUSE_UP
+			);
+			WriteVarint(recorder->file, event->button.button);
+			Recorder_WriteMouse(recorder, event->button.x, event->button.y);
+			break;
+		}
+		case SDL_MOUSEMOTION: {
+			Recorder_BeginRecord(recorder, REPLAY_RECORD_MOUSE_MOTION);
+			Recorder_WriteMouse(recorder, event->motion.x, event->motion.y);
+			break;
+		}
+		// undo and redo change the board too
+		case SDL_KEYDOWN: {
+			if(event->key.repeat) break;
+
+			Recorder_BeginRecord(recorder, REPLAY_RECORD_KEY_DOWN);
+			WriteVarint(recorder->file, (uint32_t) event->key.keysym.sym);
+			WriteVarint(recorder->file, event->key.keysym.mod);
+			break;
+		}
+	}
+}
+
+void State_RecordBoard(State* state){
+	Recorder* recorder = State_GetRecorder(state);
+	if(recorder == NULL) return;
+
+	Recorder_BeginRecord(recorder, REPLAY_RECORD_BOARD);
+	WriteVarint(recorder->file, state->board.width);
+	WriteVarint(recorder->file, state->board.height);
+	WriteVarint(recorder->file, state->board.nMines);
+}
+
+void State_RecordGameStart(State* state, int tileX, int tileY){
+	Recorder* recorder = State_GetRecorder(state);
+	if(recorder == NULL) return;
+
+	Recorder_BeginRecord(recorder, REPLAY_RECORD_GAME_START);
+	WriteVarint(recorder->file, state->game.seed);
+	WriteVarint(recorder->file, tileX);
+	WriteVarint(recorder->file, tileY);
+
+	// the same seed makes a different board inside a band
+	const DifficultyBand* band = &state->game.band;
+	WriteVarint(recorder->file, band->enabled);
+	WriteSigned(recorder->file, band->minBBBV);
+	WriteSigned(recorder->file, band->maxBBBV);
+	WriteVarint(recorder->file, band->minTechnique);
+	WriteVarint(recorder->file, band->maxTechnique);
+}
+
+typedef struct ReplayReader {
+	const uint8_t* at;
+	const uint8_t* end;
+	bool error;
+} ReplayReader;
+
+static uint64_t ReadVarint(ReplayReader* reader){
+	uint64_t value = 0;
+	for(int shift = 0; shift < 64; shift += 7){
+		if(reader->at == reader->end) break;
+
+		uint8_t byte = *reader->at++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if(!(byte & 0x80)) return value;
+	}
+
+	reader->error = true;
+	return 0;
+}
+
+static int64_t ReadSigned(ReplayReader* reader){
+	uint64_t value = ReadVarint(reader);
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+typedef struct ReplaySlowEvent {
+	uint64_t counter;
+	// us since the recording started
+	uint64_t us;
+	ReplayRecordType type;
+} ReplaySlowEvent;
+
+typedef struct ReplayStats {
+	uint64_t nEvents;
+	uint64_t nGames;
+	uint64_t nGamesWon;
+	uint64_t nGamesLost;
+	// a game started without using the seed recorded for it
+	uint64_t nDesyncs;
+
+	uint64_t handleCounter;
+	ReplaySlowEvent slowest[REPLAY_N_SLOWEST];
+} ReplayStats;
+
+static void ReplayStats_AddEvent(ReplayStats* stats, uint64_t counter, uint64_t us, ReplayRecordType type){
+	++stats->nEvents;
+	stats->handleCounter += counter;
+
+	// keep the slowest few, sorted slowest first
+	int i = REPLAY_N_SLOWEST;
+	while(i > 0 && stats->slowest[i - 1].counter < counter) --i;
+	if(i == REPLAY_N_SLOWEST) return;
+
+	memmove(&stats->slowest[i + 1], &stats->slowest[i], (REPLAY_N_SLOWEST - i - 1) * sizeof(*stats->slowest));
+	stats->slowest[i] = (ReplaySlowEvent) {
+		.counter = counter,
+		.us = us,
+		.type = type,
+	};
+}
+
+static void Replay_HandleEvent(State* state, SDL_Event* event, ReplayStats* stats, uint64_t us, ReplayRecordType type){
+	bool wasOver = state->gameOver;
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	State_HandleEvent(state, event, start);
+	ReplayStats_AddEvent(stats, SDL_GetPerformanceCounter() - start, us, type);
+
+	if(!wasOver && state->gameOver){
+		if(state->gameWon) ++stats->nGamesWon;
+		else ++stats->nGamesLost;
+	}
+}
+
+static bool Replay_SetBoard(State* state, uint64_t width, uint64_t height, uint64_t nMines){
+	if(width == 0 || height == 0 || width * height > INT32_MAX || nMines >= width * height) return false;
+
+	state->board.width = width;
+	state->board.height = height;
+	state->board.nMines = nMines;
+	State_ResetBoard(state);
+	return true;
+}
+
+static bool Replay_RunOnce(const uint8_t* data, size_t size, ReplayStats* stats){
+	ReplayReader reader = {
+		.at = data,
+		.end = data + size,
+	};
+
+	State state;
+	State_InitHeadless(&state);
+	// recorded games may undo
+	state.history = History_New();
+
+	uint64_t width = ReadVarint(&reader);
+	uint64_t height = ReadVarint(&reader);
+	uint64_t nMines = ReadVarint(&reader);
+	uint64_t layoutWidth = ReadVarint(&reader);
+	uint64_t layoutHeight = ReadVarint(&reader);
+
+	State_RecalculateLayout(&state, layoutWidth, layoutHeight);
+	if(reader.error || !Replay_SetBoard(&state, width, height, nMines)){
+		State_Destroy(&state);
+		return false;
+	}
+
+	int mouseX = 0, mouseY = 0;
+	uint64_t us = 0;
+
+	while(reader.at != reader.end && !reader.error){
+		ReplayRecordType type = *reader.at++;
+		us += ReadVarint(&reader);
+
+		SDL_Event event = { 0 };
+		switch(type){
+			case REPLAY_RECORD_MOUSE_DOWN:
+			case REPLAY_RECORD_MOUSE_UP: {
+				event.type = type == REPLAY_RECORD_MOUSE_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+				event.button.button = ReadVarint(&reader);
+				mouseX += ReadSigned(&reader);
+				mouseY += ReadSigned(&reader);
+				event.button.x = mouseX;
+				event.button.y = mouseY;
+
+				Replay_HandleEvent(&state, &event, stats, us, type);
+				break;
+			}
+			case REPLAY_RECORD_MOUSE_MOTION: {
+				event.type = SDL_MOUSEMOTION;
+				mouseX += ReadSigned(&reader);
+				mouseY += ReadSigned(&reader);
+				event.motion.x = mouseX;
+				event.motion.y = mouseY;
+
+				Replay_HandleEvent(&state, &event, stats, us, type);
+				break;
+			}
+			case REPLAY_RECORD_RESIZE: {
+				event.type = SDL_WINDOWEVENT;
+				event.window.event = SDL_WINDOWEVENT_RESIZED;
+				event.window.data1 = ReadVarint(&reader);
+				event.window.data2 = ReadVarint(&reader);
+
+				Replay_HandleEvent(&state, &event, stats, us, type);
+				break;
+			}
+			case REPLAY_RECORD_KEY_DOWN: {
+				event.type = SDL_KEYDOWN;
+				event.key.keysym.sym = (SDL_Keycode) ReadVarint(&reader);
+				event.key.keysym.mod = (Uint16) ReadVarint(&reader);
+
+				Replay_HandleEvent(&state, &event, stats, us, type);
+				break;
+			}
+			case REPLAY_RECORD_BOARD: {
+				uint64_t width = ReadVarint(&reader);
+				uint64_t height = ReadVarint(&reader);
+				uint64_t nMines = ReadVarint(&reader);
+				if(!reader.error && !Replay_SetBoard(&state, width, height, nMines)) reader.error = true;
+				break;
+			}
+			case REPLAY_RECORD_GAME_START: {
+				// recorded while the click that started the game was handled,
+				// so it comes right before that click's record
+				if(state.game.hasPendingSeed) ++stats->nDesyncs;
+
+				state.game.pendingSeed = ReadVarint(&reader);
+				state.game.hasPendingSeed = true;
+				ReadVarint(&reader);
+				ReadVarint(&reader);
+
+				// nThreads stays, the board a band search picks doesn't depend on it
+				DifficultyBand* band = &state.game.band;
+				band->enabled = ReadVarint(&reader) != 0;
+				band->minBBBV = (int) ReadSigned(&reader);
+				band->maxBBBV = (int) ReadSigned(&reader);
+				uint64_t minTechnique = ReadVarint(&reader);
+				uint64_t maxTechnique = ReadVarint(&reader);
+				if(minTechnique >= SOLVE_TECHNIQUE_COUNT || maxTechnique >= SOLVE_TECHNIQUE_COUNT){
+					reader.error = true;
+					break;
+				}
+				band->minTechnique = (SolveTechnique) minTechnique;
+				band->maxTechnique = (SolveTechnique) maxTechnique;
+				++stats->nGames;
+				break;
+			}
+			default:
+				reader.error = true;
+				break;
+		}
+	}
+
+	if(state.game.hasPendingSeed) ++stats->nDesyncs;
+
+	State_Destroy(&state);
+	return !reader.error;
+}
+
+bool Replay_Run(const char* path, int nRepeats){
+	FILE* file = fopen(path, "rb");
+	if(file == NULL){
+		fprintf(stderr, "Could not open recording \"%s\"\n", path);
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	uint8_t* data = malloc(size > 0 ? size : 1);
+	bool read = size > 0 && fread(data, 1, size, file) == (size_t) size;
+	fclose(file);
+
+	ReplayReader reader = {
+		.at = data,
+		.end = data + (read ? size : 0),
+	};
+
+	uint32_t magic = 0;
+	for(int i = 0; i < 4 && reader.at != reader.end; ++i){
+		magic |= (uint32_t) *reader.at++ << (i * 8);
+	}
+	uint64_t version = ReadVarint(&reader);
+
+	if(!read || reader.error || magic != REPLAY_MAGIC || version != REPLAY_VERSION){
+		fprintf(stderr, "\"%s\" is not a recording\n", path);
+		free(data);
+		return false;
+	}
+
+	ReplayStats stats = { 0 };
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < nRepeats; ++i){
+		if(!Replay_RunOnce(reader.at, reader.end - reader.at, &stats)){
+			fprintf(stderr, "Recording \"%s\" is corrupt\n", path);
+			free(data);
+			return false;
+		}
+	}
+	double frequency = (double) SDL_GetPerformanceFrequency();
+	double seconds = (SDL_GetPerformanceCounter() - start) / frequency;
+
+	free(data);
+
+	printf(
+		"Replayed \"%s\" %d times in %.2f ms (%.2f ms handling events)\n",
+		path,
+		nRepeats,
+		seconds * 1000.0,
+		stats.handleCounter * 1000.0 / frequency
+	);
+	printf(
+		"\t%llu events, %.0f events/s\n",
+		(unsigned long long) stats.nEvents,
+		stats.nEvents / seconds
+	);
+	printf(
+		"\t%llu games (%llu won, %llu lost), %.0f games/s\n",
+		(unsigned long long) stats.nGames,
+		(unsigned long long) stats.nGamesWon,
+		(unsigned long long) stats.nGamesLost,
+		stats.nGames / seconds
+	);
+	if(stats.nDesyncs != 0){
+		printf("\t%llu recorded seeds went unused, the replay diverged\n", (unsigned long long) stats.nDesyncs);
+	}
+
+	printf("Slowest events:\n");
+	for(int i = 0; i < REPLAY_N_SLOWEST && stats.slowest[i].counter != 0; ++i){
+		ReplaySlowEvent* slow = &stats.slowest[i];
+		printf(
+			"\t%8.3f ms  %s at %.3f ms\n",
+			slow->counter * 1000.0 / frequency,
+			REPLAY_RECORD_NAMES[slow->type],
+			slow->us / 1000.0
+		);
+	}
+
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+struct State;
+
+// recordings hold every event State_HandleEvent reacts to, the board each menu
+// command created, and the seed and first click of every game
+// only default gamemode games are recorded, custom ones depend on a script
+
+bool State_StartRecording(struct State*, const char* path);
+void State_StopRecording(struct State*);
+
+// all of these do nothing if the state isn't recording
+void State_RecordEvent(struct State*, const SDL_Event*);
+void State_RecordBoard(struct State*);
+void State_RecordGameStart(struct State*, int tileX, int tileY);
+
+// feeds a recording through State_HandleEvent on a headless state, as fast as possible,
+// nRepeats times over, then prints throughput and the slowest events
+// returns false if the recording couldn't be read
+bool Replay_Run(const char* path, int nRepeats);
@@ -1,8 +1,23 @@
 #pragma once
 
 struct State;
+struct EmbeddedImage;
 
 SDL_Texture* State_LoadTextureFromPath(State* state, const char* path);
 
+// uploads the cute tilesheet on first use, waiting for it to be decoded if needed
+SDL_Texture* State_GetCuteTexture(struct State*);
+void State_DestroyPendingThemes(struct State*);
+
+// decodes a custom tilesheet on a worker thread and reloads it whenever the file changes
+void State_LoadCustomTheme(struct State*, const wchar_t* path, const char* pathMB);
+// uploads a newly decoded custom tilesheet, call once per frame
+void State_PollCustomTheme(struct State*);
+void State_StopCustomTheme(struct State*);
+
 void State_LoadResources(struct State*);
+// decodes on the calling thread, for the state's renderer
+SDL_Texture* State_LoadEmbeddedTexture(struct State*, const struct EmbeddedImage*);
+// where each sprite is in the tilesheets
+void State_LoadSpriteRects(struct State*);
 void State_UpdateBackgroundColor(struct State*);
\ No newline at end of file
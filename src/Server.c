@@ -0,0 +1,745 @@
+#include "Server.h"
+#include "State.h"
+#include "Random.h"
+#include "Repair.h"
+#include "Constants.h"
+
+#include <winsock2.h>
+#include <afunix.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+// closes every session of the connection, sent to every shard once it's gone
+#define SERVER_OP_DISCONNECT SERVER_OP_COUNT
+
+// tile bits a session keeps, TILE_STATE_PRESSED only matters to a mouse
+#define SERVER_TILE_STATE_MASK (TILE_STATE_INITIALIZED | TILE_STATE_MINE | TILE_STATE_FLAG | TILE_STATE_UNCOVERED)
+#define SERVER_TILE_MINES_SHIFT 4
+
+// older SDKs don't have it, the tag AF_UNIX sockets are created with
+#ifndef IO_REPARSE_TAG_AF_UNIX
+#define IO_REPARSE_TAG_AF_UNIX 0x80000023L
+#endif
+
+typedef struct ServerRequest {
+	uint32_t tag;
+	uint32_t session;
+	uint8_t op;
+	uint16_t x, y;
+	uint32_t nMines;
+	uint64_t seed;
+} ServerRequest;
+
+struct Server;
+
+// every connection is read and written by the server's one I/O thread, without blocking
+// responses are queued for it, so a client that's slow to read never holds up the shards
+// playing everyone else's moves
+// a client sending faster than its shard plays isn't read from until the shard has room again,
+// the I/O thread itself never waits for a shard
+typedef struct ServerConnection {
+	SOCKET socket;
+	struct Server* server;
+	// held by the I/O thread until it lets go of the connection, and by every request of it still queued
+	SDL_atomic_t refs;
+	// the client stopped sending, only waiting for its sessions to close and its responses to go out
+	SDL_atomic_t closing;
+
+	// only the I/O thread touches these
+	// shards told to close its sessions so far, the rest had no room in their queue yet
+	int nDisconnected;
+	// requests read but not handed to their shard yet, the last one may not have arrived whole
+	uint8_t in[SERVER_READ_REQUESTS * SERVER_REQUEST_SIZE];
+	int inSize;
+	// a request's shard had no room for it, nothing more is read until it's handed out
+	bool blocked;
+	// where the SERVER_OP_NEW that's blocked goes, -1 if there isn't one
+	int newShard;
+
+	SDL_mutex* outLock;
+	// responses not sent yet, from every shard, outStart is how much of it went out already
+	uint8_t* out;
+	size_t outStart, outSize, outCapacity;
+	// the client stopped reading or went away, anything queued is dropped
+	bool dead;
+} ServerConnection;
+
+typedef struct ServerJob {
+	ServerConnection* connection;
+	ServerRequest request;
+} ServerJob;
+
+typedef struct ServerSession {
+	// NULL while the slot is free
+	ServerConnection* owner;
+
+	int width, height, nMines;
+	int tilesLeft, minesFlagged;
+	bool gameStarted, gameOver, gameWon;
+	uint64_t seed;
+	uint64_t counterStarted, counterEnded;
+
+	// TileState in the low bits, surrounding mines in the high ones
+	uint8_t* tiles;
+} ServerSession;
+
+typedef struct ServerShard {
+	SDL_Thread* thread;
+	struct Server* server;
+	int id;
+	int nShards;
+
+	SDL_mutex* lock;
+	SDL_cond* notEmpty;
+	ServerJob jobs[SERVER_QUEUE_SIZE];
+	int head, nJobs;
+	// the I/O thread found the queue full, it's woken up once there's room
+	bool full;
+
+	// only the shard's thread touches anything below
+	// every move is played on this state, it holds the board of one session at a time
+	State state;
+	size_t nStateTiles;
+	Random random;
+
+	// a session's id is its slot * nShards + the shard's id
+	ServerSession* sessions;
+	int nSessions;
+	int* freeSlots;
+	int nFreeSlots;
+} ServerShard;
+
+typedef struct Server {
+	ServerShard* shards;
+	int nShards;
+	// new sessions go round robin
+	SDL_atomic_t nextShard;
+
+	// only the I/O thread touches these
+	ServerConnection** connections;
+	int nConnections, connectionsCapacity;
+	WSAPOLLFD* polled;
+
+	// a connection to the server itself, a byte sent on it wakes the I/O thread up
+	// from WSAPoll when a shard queued output, let go of a closing connection or has room in its queue again
+	SOCKET wakeSender, wakeReceiver;
+	// a wake up byte was sent and not received yet, so there's never more than one
+	SDL_atomic_t woken;
+} Server;
+
+static void PutU16(uint8_t* at, uint16_t value){
+	at[0] = (uint8_t) value;
+	at[1] = (uint8_t) (value >> 8);
+}
+
+static void PutU32(uint8_t* at, uint32_t value){
+	for(int i = 0; i < 4; ++i) at[i] = (uint8_t) (value >> (8 * i));
+}
+
+static void PutU64(uint8_t* at, uint64_t value){
+	for(int i = 0; i < 8; ++i) at[i] = (uint8_t) (value >> (8 * i));
+}
+
+static uint16_t GetU16(const uint8_t* at){
+	return (uint16_t) (at[0] | at[1] << 8);
+}
+
+static uint32_t GetU32(const uint8_t* at){
+	uint32_t value = 0;
+	for(int i = 0; i < 4; ++i) value |= (uint32_t) at[i] << (8 * i);
+	return value;
+}
+
+static uint64_t GetU64(const uint8_t* at){
+	uint64_t value = 0;
+	for(int i = 0; i < 8; ++i) value |= (uint64_t) at[i] << (8 * i);
+	return value;
+}
+
+static void Server_Wake(Server* server){
+	if(SDL_AtomicCAS(&server->woken, 0, 1)) send(server->wakeSender, "", 1, 0);
+}
+
+static void Server_ReleaseConnection(ServerConnection* connection){
+	// read before letting go, the I/O thread can free it right after
+	Server* server = connection->server;
+	bool closing = SDL_AtomicGet(&connection->closing);
+
+	// down to the I/O thread's own reference, a closing connection can go once its output has
+	if(SDL_AtomicAdd(&connection->refs, -1) == 2 && closing) Server_Wake(server);
+}
+
+static void ServerConnection_Kill(ServerConnection* connection){
+	connection->dead = true;
+	connection->outStart = 0;
+	connection->outSize = 0;
+}
+
+static void Server_Respond(ServerConnection* connection, uint8_t* response, const uint8_t* payload, int payloadSize){
+	PutU32(response + 20, (uint32_t) payloadSize);
+	size_t size = SERVER_RESPONSE_SIZE + payloadSize;
+
+	SDL_LockMutex(connection->outLock);
+	bool wasDead = connection->dead;
+	bool wasEmpty = connection->outSize == connection->outStart;
+	if(!connection->dead && connection->outSize - connection->outStart + size > SERVER_MAX_OUTPUT){
+		fprintf(stderr, "Dropping a client that stopped reading its responses\n");
+		ServerConnection_Kill(connection);
+	}
+	if(!connection->dead){
+		if(connection->outSize + size > connection->outCapacity){
+			// what was sent already makes room first
+			memmove(connection->out, connection->out + connection->outStart, connection->outSize - connection->outStart);
+			connection->outSize -= connection->outStart;
+			connection->outStart = 0;
+		}
+		if(connection->outSize + size > connection->outCapacity){
+			connection->outCapacity = KET_MAX(connection->outCapacity * 2, connection->outSize + size);
+			connection->out = realloc(connection->out, connection->outCapacity);
+		}
+		memcpy(connection->out + connection->outSize, response, SERVER_RESPONSE_SIZE);
+		if(payloadSize > 0) memcpy(connection->out + connection->outSize + SERVER_RESPONSE_SIZE, payload, payloadSize);
+		connection->outSize += size;
+	}
+	bool wake = connection->dead ? !wasDead : wasEmpty;
+	SDL_UnlockMutex(connection->outLock);
+
+	// the I/O thread only polls for writing while there's something to send
+	if(wake) Server_Wake(connection->server);
+}
+
+// never waits, the one I/O thread can't stop for a shard that's behind
+// returns false if the shard's queue is full
+static bool ServerShard_Push(ServerShard* shard, ServerConnection* connection, const ServerRequest* request){
+	SDL_LockMutex(shard->lock);
+	bool pushed = shard->nJobs < SERVER_QUEUE_SIZE;
+	if(pushed){
+		SDL_AtomicIncRef(&connection->refs);
+		shard->jobs[(shard->head + shard->nJobs) % SERVER_QUEUE_SIZE] = (ServerJob) {
+			.connection = connection,
+			.request = *request,
+		};
+		++shard->nJobs;
+		SDL_CondSignal(shard->notEmpty);
+	}
+	else{
+		shard->full = true;
+	}
+	SDL_UnlockMutex(shard->lock);
+	return pushed;
+}
+
+static ServerSession* ServerShard_GetSession(ServerShard* shard, const ServerJob* job){
+	int slot = (int) (job->request.session / shard->nShards);
+	if((int) (job->request.session % shard->nShards) != shard->id || slot >= shard->nSessions) return NULL;
+
+	ServerSession* session = &shard->sessions[slot];
+	return session->owner == job->connection ? session : NULL;
+}
+
+static void ServerShard_CloseSession(ServerShard* shard, ServerSession* session){
+	free(session->tiles);
+	memset(session, 0, sizeof(*session));
+	shard->freeSlots[shard->nFreeSlots++] = (int) (session - shard->sessions);
+}
+
+static ServerStatus ServerShard_NewSession(ServerShard* shard, const ServerJob* job, uint32_t* id){
+	const ServerRequest* request = &job->request;
+	int width = request->x, height = request->y;
+	if((size_t) width * height > SERVER_MAX_TILES || request->nMines > SERVER_MAX_TILES){
+		return SERVER_STATUS_INVALID;
+	}
+	// the first click would never find a board otherwise
+	if(!Repair_CanGenerate(width, height, (int) request->nMines)) return SERVER_STATUS_INVALID;
+	int nTiles = width * height;
+
+	if(shard->nFreeSlots == 0){
+		int capacity = KET_MAX(shard->nSessions * 2, 64);
+		shard->sessions = realloc(shard->sessions, capacity * sizeof(*shard->sessions));
+		shard->freeSlots = realloc(shard->freeSlots, capacity * sizeof(*shard->freeSlots));
+		memset(shard->sessions + shard->nSessions, 0, (capacity - shard->nSessions) * sizeof(*shard->sessions));
+
+		// lowest slots first
+		for(int slot = capacity - 1; slot >= shard->nSessions; --slot){
+			shard->freeSlots[shard->nFreeSlots++] = slot;
+		}
+		shard->nSessions = capacity;
+	}
+
+	int slot = shard->freeSlots[--shard->nFreeSlots];
+	ServerSession* session = &shard->sessions[slot];
+	*session = (ServerSession) {
+		.owner = job->connection,
+		.width = width,
+		.height = height,
+		.nMines = (int) request->nMines,
+		.tilesLeft = nTiles,
+		.seed = request->seed != 0 ? request->seed : (uint64_t) Random_Next(&shard->random) << 32 | Random_Next(&shard->random),
+		.tiles = calloc(nTiles, 1),
+	};
+
+	*id = (uint32_t) slot * shard->nShards + shard->id;
+	return SERVER_STATUS_OK;
+}
+
+// unpacks the session into the shard's state, so the game's own functions can play it
+static void ServerShard_Load(ServerShard* shard, const ServerSession* session){
+	State* state = &shard->state;
+	size_t nTiles = (size_t) session->width * session->height;
+	if(nTiles > shard->nStateTiles){
+		state->board.tiles = realloc(state->board.tiles, nTiles * sizeof(*state->board.tiles));
+		shard->nStateTiles = nTiles;
+	}
+
+	for(size_t i = 0; i < nTiles; ++i){
+		state->board.tiles[i] = (Tile) {
+			.state = session->tiles[i] & SERVER_TILE_STATE_MASK,
+			.surroundingMines = session->tiles[i] >> SERVER_TILE_MINES_SHIFT,
+		};
+	}
+
+	state->board.width = session->width;
+	state->board.height = session->height;
+	state->board.nMines = session->nMines;
+	state->board.tilesLeft = session->tilesLeft;
+	state->board.minesFlagged = session->minesFlagged;
+	state->gameStarted = session->gameStarted;
+	state->gameOver = session->gameOver;
+	state->gameWon = session->gameWon;
+	state->counterStarted = session->counterStarted;
+	state->counterEnded = session->counterEnded;
+
+	// the first click generates the board from the session's seed
+	state->game.hasPendingSeed = !session->gameStarted;
+	state->game.pendingSeed = session->seed;
+}
+
+static void ServerShard_Store(ServerShard* shard, ServerSession* session){
+	const State* state = &shard->state;
+	size_t nTiles = (size_t) session->width * session->height;
+	for(size_t i = 0; i < nTiles; ++i){
+		const Tile* tile = &state->board.tiles[i];
+		session->tiles[i] = (uint8_t) ((tile->state & SERVER_TILE_STATE_MASK) | tile->surroundingMines << SERVER_TILE_MINES_SHIFT);
+	}
+
+	session->tilesLeft = state->board.tilesLeft;
+	session->minesFlagged = state->board.minesFlagged;
+	session->gameStarted = state->gameStarted;
+	session->gameOver = state->gameOver;
+	session->gameWon = state->gameWon;
+	session->counterStarted = state->counterStarted;
+	session->counterEnded = state->counterEnded;
+}
+
+static ServerStatus ServerShard_Move(ServerShard* shard, ServerSession* session, const ServerRequest* request){
+	if(request->x >= session->width || request->y >= session->height) return SERVER_STATUS_INVALID;
+	if(session->gameOver) return SERVER_STATUS_GAME_OVER;
+
+	ServerShard_Load(shard, session);
+	if(request->op == SERVER_OP_CLICK){
+		bool flagged = shard->state.board.tiles[request->x + request->y * session->width].state & TILE_STATE_FLAG;
+		State_ClickTile(&shard->state, request->x, request->y);
+		// the session stays as it was, the same click would fail the same way
+		if(!shard->state.gameStarted && !flagged) return SERVER_STATUS_UNSOLVABLE;
+	}
+	else{
+		State_FlagTile(&shard->state, request->x, request->y);
+	}
+	ServerShard_Store(shard, session);
+	return SERVER_STATUS_OK;
+}
+
+static uint8_t* ServerSession_Encode(const ServerSession* session, int* size){
+	int nTiles = session->width * session->height;
+	*size = SERVER_BOARD_HEADER_SIZE + nTiles;
+	uint8_t* payload = malloc(*size);
+
+	uint64_t end = session->gameOver ? session->counterEnded : SDL_GetPerformanceCounter();
+	uint64_t ms = session->gameStarted ? (end - session->counterStarted) * 1000 / SDL_GetPerformanceFrequency() : 0;
+
+	PutU16(payload, (uint16_t) session->width);
+	PutU16(payload + 2, (uint16_t) session->height);
+	PutU32(payload + 4, (uint32_t) session->nMines);
+	PutU64(payload + 8, session->seed);
+	PutU32(payload + 16, (uint32_t) KET_MIN(ms, UINT32_MAX));
+
+	uint8_t* tiles = payload + SERVER_BOARD_HEADER_SIZE;
+	for(int i = 0; i < nTiles; ++i){
+		uint8_t tile = session->tiles[i];
+		if(tile & TILE_STATE_UNCOVERED && !(tile & TILE_STATE_MINE)) tiles[i] = tile >> SERVER_TILE_MINES_SHIFT;
+		else if(tile & TILE_STATE_MINE && session->gameOver) tiles[i] = SERVER_TILE_MINE;
+		else if(tile & TILE_STATE_FLAG) tiles[i] = SERVER_TILE_FLAG;
+		else tiles[i] = SERVER_TILE_COVERED;
+	}
+	return payload;
+}
+
+static void ServerShard_Run(ServerShard* shard, const ServerJob* job){
+	const ServerRequest* request = &job->request;
+
+	if(request->op == SERVER_OP_DISCONNECT){
+		for(int slot = 0; slot < shard->nSessions; ++slot){
+			if(shard->sessions[slot].owner == job->connection){
+				ServerShard_CloseSession(shard, &shard->sessions[slot]);
+			}
+		}
+		return;
+	}
+
+	uint32_t id = request->session;
+	ServerStatus status = SERVER_STATUS_OK;
+	ServerSession* session = NULL;
+	uint8_t* payload = NULL;
+	int payloadSize = 0;
+
+	if(request->op == SERVER_OP_NEW){
+		status = ServerShard_NewSession(shard, job, &id);
+		if(status == SERVER_STATUS_OK) session = &shard->sessions[id / shard->nShards];
+	}
+	else if((session = ServerShard_GetSession(shard, job)) == NULL){
+		status = SERVER_STATUS_UNKNOWN_SESSION;
+	}
+	else if(request->op == SERVER_OP_CLICK || request->op == SERVER_OP_FLAG){
+		status = ServerShard_Move(shard, session, request);
+	}
+	else if(request->op == SERVER_OP_GET){
+		payload = ServerSession_Encode(session, &payloadSize);
+	}
+
+	uint8_t response[SERVER_RESPONSE_SIZE] = { 0 };
+	PutU32(response, request->tag);
+	PutU32(response + 4, id);
+	response[8] = (uint8_t) status;
+	if(session != NULL){
+		response[9] = !session->gameStarted ? SERVER_GAME_READY
+			: !session->gameOver ? SERVER_GAME_PLAYING
+			: session->gameWon ? SERVER_GAME_WON
+			: SERVER_GAME_LOST;
+		PutU32(response + 12, (uint32_t) session->tilesLeft);
+		PutU32(response + 16, (uint32_t) session->minesFlagged);
+
+		if(request->op == SERVER_OP_CLOSE) ServerShard_CloseSession(shard, session);
+	}
+
+	Server_Respond(job->connection, response, payload, payloadSize);
+	free(payload);
+}
+
+static int ServerShardThread(void* data){
+	ServerShard* shard = data;
+
+	for(;;){
+		SDL_LockMutex(shard->lock);
+		while(shard->nJobs == 0) SDL_CondWait(shard->notEmpty, shard->lock);
+
+		ServerJob job = shard->jobs[shard->head];
+		shard->head = (shard->head + 1) % SERVER_QUEUE_SIZE;
+		--shard->nJobs;
+		bool wasFull = shard->full;
+		shard->full = false;
+		SDL_UnlockMutex(shard->lock);
+
+		// a connection may be waiting to hand it a request
+		if(wasFull) Server_Wake(shard->server);
+
+		ServerShard_Run(shard, &job);
+		Server_ReleaseConnection(job.connection);
+	}
+
+	return 0;
+}
+
+// returns false if the request's shard has no room for it
+static bool Server_Dispatch(Server* server, ServerConnection* connection, const uint8_t* buffer){
+	ServerRequest request = {
+		.tag = GetU32(buffer),
+		.session = GetU32(buffer + 4),
+		.op = buffer[8],
+		.x = GetU16(buffer + 12),
+		.y = GetU16(buffer + 14),
+		.nMines = GetU32(buffer + 16),
+		.seed = GetU64(buffer + 24),
+	};
+
+	if(request.op >= SERVER_OP_COUNT){
+		uint8_t response[SERVER_RESPONSE_SIZE] = { 0 };
+		PutU32(response, request.tag);
+		PutU32(response + 4, request.session);
+		response[8] = SERVER_STATUS_UNKNOWN_OP;
+		Server_Respond(connection, response, NULL, 0);
+		return true;
+	}
+
+	// picked once, a new session going back to a full shard stays on it
+	if(request.op == SERVER_OP_NEW && connection->newShard < 0){
+		connection->newShard = (int) ((unsigned int) SDL_AtomicAdd(&server->nextShard, 1) % server->nShards);
+	}
+	int shard = request.op == SERVER_OP_NEW ? connection->newShard : (int) (request.session % server->nShards);
+	if(!ServerShard_Push(&server->shards[shard], connection, &request)) return false;
+
+	if(request.op == SERVER_OP_NEW) connection->newShard = -1;
+	return true;
+}
+
+// hands out every whole request read so far, stopping at one whose shard is full
+static void Server_DispatchInput(Server* server, ServerConnection* connection){
+	int at = 0;
+	for(; connection->inSize - at >= SERVER_REQUEST_SIZE; at += SERVER_REQUEST_SIZE){
+		if(!Server_Dispatch(server, connection, connection->in + at)) break;
+	}
+	connection->inSize -= at;
+	memmove(connection->in, connection->in + at, connection->inSize);
+	connection->blocked = connection->inSize >= SERVER_REQUEST_SIZE;
+}
+
+// at most SERVER_READ_REQUESTS at a time, so a client sending nonstop can't starve the rest
+// returns false once the client stopped sending
+static bool Server_Read(Server* server, ServerConnection* connection){
+	int n = recv(connection->socket, (char*) connection->in + connection->inSize, (int) sizeof(connection->in) - connection->inSize, 0);
+	if(n == 0) return false;
+	if(n == SOCKET_ERROR) return WSAGetLastError() == WSAEWOULDBLOCK;
+
+	connection->inSize += n;
+	Server_DispatchInput(server, connection);
+	return true;
+}
+
+// sends what the socket takes without blocking
+static void Server_Write(ServerConnection* connection){
+	SDL_LockMutex(connection->outLock);
+	while(connection->outStart < connection->outSize){
+		int n = send(
+			connection->socket,
+			(const char*) connection->out + connection->outStart,
+			(int) (connection->outSize - connection->outStart),
+			0
+		);
+		if(n == SOCKET_ERROR){
+			if(WSAGetLastError() != WSAEWOULDBLOCK) ServerConnection_Kill(connection);
+			break;
+		}
+		connection->outStart += n;
+	}
+	if(connection->outStart == connection->outSize){
+		connection->outStart = 0;
+		connection->outSize = 0;
+	}
+	SDL_UnlockMutex(connection->outLock);
+}
+
+// tells the shards to close its sessions, as many as have room in their queue
+static void Server_Disconnect(Server* server, ServerConnection* connection){
+	ServerRequest disconnect = { .op = SERVER_OP_DISCONNECT };
+	while(
+		connection->nDisconnected < server->nShards
+		&& ServerShard_Push(&server->shards[connection->nDisconnected], connection, &disconnect)
+	){
+		++connection->nDisconnected;
+	}
+}
+
+// the shards close its sessions, the I/O thread lets go of it once they're done and its output went out
+static void Server_Close(Server* server, ServerConnection* connection){
+	SDL_AtomicSet(&connection->closing, 1);
+	// requests still waiting for a shard are dropped with the client
+	connection->inSize = 0;
+	connection->blocked = false;
+	Server_Disconnect(server, connection);
+}
+
+static void Server_Accept(Server* server, SOCKET listener){
+	SOCKET client;
+	while((client = accept(listener, NULL, NULL)) != INVALID_SOCKET){
+		u_long nonBlocking = 1;
+		ioctlsocket(client, FIONBIO, &nonBlocking);
+
+		ServerConnection* connection = calloc(1, sizeof(*connection));
+		connection->socket = client;
+		connection->server = server;
+		connection->outLock = SDL_CreateMutex();
+		connection->newShard = -1;
+		SDL_AtomicSet(&connection->refs, 1);
+
+		if(server->nConnections == server->connectionsCapacity){
+			server->connectionsCapacity = KET_MAX(server->connectionsCapacity * 2, 64);
+			server->connections = realloc(server->connections, server->connectionsCapacity * sizeof(*server->connections));
+			// the listener and the wake up socket come first
+			server->polled = realloc(server->polled, (2 + server->connectionsCapacity) * sizeof(*server->polled));
+		}
+		server->connections[server->nConnections++] = connection;
+	}
+}
+
+static void Server_Serve(Server* server, SOCKET listener){
+	for(;;){
+		server->polled[0] = (WSAPOLLFD) { .fd = listener, .events = POLLRDNORM };
+		server->polled[1] = (WSAPOLLFD) { .fd = server->wakeReceiver, .events = POLLRDNORM };
+
+		for(int i = 0; i < server->nConnections; ++i){
+			ServerConnection* connection = server->connections[i];
+			SHORT events = 0;
+			if(!SDL_AtomicGet(&connection->closing) && !connection->blocked) events |= POLLRDNORM;
+			SDL_LockMutex(connection->outLock);
+			if(connection->outSize > connection->outStart) events |= POLLWRNORM;
+			SDL_UnlockMutex(connection->outLock);
+
+			// a closing or blocked connection with nothing to send only waits for a wake up, a hung up socket
+			// would have WSAPoll return right away otherwise
+			server->polled[2 + i] = (WSAPOLLFD) {
+				.fd = events != 0 ? connection->socket : INVALID_SOCKET,
+				.events = events,
+			};
+		}
+
+		if(WSAPoll(server->polled, 2 + server->nConnections, -1) == SOCKET_ERROR){
+			fprintf(stderr, "Could not poll the server's sockets: error %d\n", WSAGetLastError());
+			return;
+		}
+
+		if(server->polled[1].revents != 0){
+			char wakeUps[64];
+			while(recv(server->wakeReceiver, wakeUps, sizeof(wakeUps), 0) > 0);
+			// after the byte is gone, anything a shard changed before sending it is seen below
+			SDL_AtomicSet(&server->woken, 0);
+		}
+
+		// backwards, a connection that's let go of is replaced by the last one, which is already done
+		for(int i = server->nConnections - 1; i >= 0; --i){
+			ServerConnection* connection = server->connections[i];
+			SHORT revents = server->polled[2 + i].revents;
+
+			// woken up by a shard that has room again
+			if(connection->blocked) Server_DispatchInput(server, connection);
+			else if(revents & (POLLRDNORM | POLLHUP | POLLERR) && !SDL_AtomicGet(&connection->closing)){
+				if(!Server_Read(server, connection)) Server_Close(server, connection);
+			}
+			if(revents & (POLLWRNORM | POLLHUP | POLLERR)) Server_Write(connection);
+
+			SDL_LockMutex(connection->outLock);
+			bool dead = connection->dead;
+			SDL_UnlockMutex(connection->outLock);
+
+			if(dead && !SDL_AtomicGet(&connection->closing)) Server_Close(server, connection);
+			if(!SDL_AtomicGet(&connection->closing)) continue;
+			if(connection->nDisconnected < server->nShards) Server_Disconnect(server, connection);
+			if(connection->nDisconnected < server->nShards || SDL_AtomicGet(&connection->refs) > 1) continue;
+
+			// no shard holds it anymore, so nothing is queued after this
+			SDL_LockMutex(connection->outLock);
+			bool sent = connection->outSize == connection->outStart;
+			SDL_UnlockMutex(connection->outLock);
+			if(!sent) continue;
+
+			closesocket(connection->socket);
+			SDL_DestroyMutex(connection->outLock);
+			free(connection->out);
+			free(connection);
+			server->connections[i] = server->connections[--server->nConnections];
+		}
+
+		if(server->polled[0].revents != 0) Server_Accept(server, listener);
+	}
+}
+
+// a socket left behind by the last server, nothing can connect to it anymore
+// anything else at path isn't ours to delete
+static bool Server_RemoveStaleSocket(const char* path){
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA(path, &found);
+	if(find == INVALID_HANDLE_VALUE) return true;
+	FindClose(find);
+
+	if(found.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT && found.dwReserved0 == IO_REPARSE_TAG_AF_UNIX){
+		if(DeleteFileA(path)) return true;
+		fprintf(stderr, "Could not delete the old socket \"%s\": error %lu\n", path, GetLastError());
+		return false;
+	}
+
+	fprintf(stderr, "Could not listen on \"%s\": the path exists and isn't a socket\n", path);
+	return false;
+}
+
+bool Server_Run(const char* path, int nThreads){
+	WSADATA wsaData;
+	if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0){
+		fprintf(stderr, "Could not initialize Winsock\n");
+		return false;
+	}
+
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if(strlen(path) >= sizeof(address.sun_path)){
+		fprintf(stderr, "Socket path \"%s\" is too long\n", path);
+		WSACleanup();
+		return false;
+	}
+	strcpy(address.sun_path, path);
+
+	if(!Server_RemoveStaleSocket(path)){
+		WSACleanup();
+		return false;
+	}
+
+	SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(
+		listener == INVALID_SOCKET
+		|| bind(listener, (struct sockaddr*) &address, sizeof(address)) == SOCKET_ERROR
+		|| listen(listener, SOMAXCONN) == SOCKET_ERROR
+	){
+		fprintf(stderr, "Could not listen on \"%s\": error %d\n", path, WSAGetLastError());
+		if(listener != INVALID_SOCKET) closesocket(listener);
+		WSACleanup();
+		return false;
+	}
+
+	Server server = {
+		.shards = calloc(nThreads, sizeof(*server.shards)),
+		.nShards = nThreads,
+		.polled = malloc(2 * sizeof(*server.polled)),
+	};
+
+	// the listener is still blocking, so the connection is waiting to be accepted
+	server.wakeSender = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(
+		server.wakeSender == INVALID_SOCKET
+		|| connect(server.wakeSender, (struct sockaddr*) &address, sizeof(address)) == SOCKET_ERROR
+		|| (server.wakeReceiver = accept(listener, NULL, NULL)) == INVALID_SOCKET
+	){
+		fprintf(stderr, "Could not connect to \"%s\": error %d\n", path, WSAGetLastError());
+		if(server.wakeSender != INVALID_SOCKET) closesocket(server.wakeSender);
+		closesocket(listener);
+		free(server.shards);
+		free(server.polled);
+		WSACleanup();
+		return false;
+	}
+
+	u_long nonBlocking = 1;
+	ioctlsocket(listener, FIONBIO, &nonBlocking);
+	ioctlsocket(server.wakeReceiver, FIONBIO, &nonBlocking);
+
+	for(int i = 0; i < nThreads; ++i){
+		ServerShard* shard = &server.shards[i];
+		shard->server = &server;
+		shard->id = i;
+		shard->nShards = nThreads;
+		shard->lock = SDL_CreateMutex();
+		shard->notEmpty = SDL_CreateCond();
+
+		State_InitHeadless(&shard->state);
+		shard->nStateTiles = shard->state.board.width * shard->state.board.height;
+		Random_Seed(&shard->random, SDL_GetPerformanceCounter() + i);
+
+		shard->thread = SDL_CreateThread(ServerShardThread, "ServerShard", shard);
+	}
+
+	printf("Serving on %s with %d shards\n", path, nThreads);
+	fflush(stdout);
+
+	// only returns if polling fails, the shards are left running as the process exits
+	Server_Serve(&server, listener);
+	return false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// hosts many headless games at once for bots, over a Unix domain socket
+//
+// sessions are spread over shards, each one a thread with its own headless State
+// a session only keeps its board packed one byte per tile, it's unpacked into its
+// shard's State for every move, so moves go through State_ClickTile and State_FlagTile
+// and play by exactly the same rules as the game
+//
+// every integer is little endian
+// a client sends fixed size requests:
+//   0  u32  tag, echoed back in the response
+//   4  u32  session, ignored by SERVER_OP_NEW
+//   8  u8   op, a ServerOp
+//   9  u8   reserved, 3 bytes
+//   12 u16  x, or width for SERVER_OP_NEW
+//   14 u16  y, or height for SERVER_OP_NEW
+//   16 u32  mines, for SERVER_OP_NEW
+//   20 u32  reserved
+//   24 u64  seed for SERVER_OP_NEW, 0 picks one
+// and gets one response per request, in order per session but not across sessions:
+//   0  u32  tag
+//   4  u32  session
+//   8  u8   status, a ServerStatus
+//   9  u8   game, a ServerGame
+//   10 u16  reserved
+//   12 u32  covered tiles left
+//   16 u32  flags placed
+//   20 u32  size of the payload that follows
+// SERVER_OP_GET's payload is:
+//   0  u16  width
+//   2  u16  height
+//   4  u32  mines
+//   8  u64  seed
+//   16 u32  ms played, so far or until the game ended
+//   20 u8   width * height tiles, row by row, each a ServerTile
+//
+// the same seed and first click always make the same board
+// sessions belong to the connection that created them and are closed when it disconnects
+
+#define SERVER_REQUEST_SIZE 32
+#define SERVER_RESPONSE_SIZE 24
+#define SERVER_BOARD_HEADER_SIZE 20
+
+typedef enum ServerOp {
+	// width, height, mines and seed, the board is generated on the first click
+	SERVER_OP_NEW,
+	SERVER_OP_CLICK,
+	SERVER_OP_FLAG,
+	SERVER_OP_GET,
+	SERVER_OP_CLOSE,
+	SERVER_OP_COUNT,
+} ServerOp;
+
+typedef enum ServerStatus {
+	SERVER_STATUS_OK,
+	SERVER_STATUS_UNKNOWN_OP,
+	// not a session of this connection
+	SERVER_STATUS_UNKNOWN_SESSION,
+	// a board that can't be generated, or a tile outside the board
+	SERVER_STATUS_INVALID,
+	// moves after the game ended
+	SERVER_STATUS_GAME_OVER,
+	// the first click found no solvable board for the session's seed, it's still waiting for one
+	SERVER_STATUS_UNSOLVABLE,
+} ServerStatus;
+
+typedef enum ServerGame {
+	// no click yet, so no mines yet
+	SERVER_GAME_READY,
+	SERVER_GAME_PLAYING,
+	SERVER_GAME_WON,
+	SERVER_GAME_LOST,
+} ServerGame;
+
+typedef enum ServerTile {
+	// 0 to 8 are uncovered numbers
+	SERVER_TILE_COVERED = 9,
+	SERVER_TILE_FLAG,
+	// only once the game is over, like the game shows them
+	SERVER_TILE_MINE,
+} ServerTile;
+
+// serves on path until the process is killed, with nThreads shards and one thread
+// reading and writing every connection
+// a socket left at path by an earlier server is replaced, anything else there is an error
+// returns false if it couldn't listen
+bool Server_Run(const char* path, int nThreads);
@@ -0,0 +1,258 @@
+#include "Snapshot.h"
+#include "State.h"
+#include "History.h"
+#include "Constants.h"
+#include "Win.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <SDL.h>
+
+#define SNAPSHOT_STARTED 0x1
+#define SNAPSHOT_OVER 0x2
+#define SNAPSHOT_WON 0x4
+
+// Neighborhood without what's derived from it
+typedef struct SnapshotRules {
+	int32_t n;
+	int32_t wrap;
+	int8_t dx[NEIGHBORHOOD_MAX_OFFSETS];
+	int8_t dy[NEIGHBORHOOD_MAX_OFFSETS];
+	int8_t weight[NEIGHBORHOOD_MAX_OFFSETS];
+} SnapshotRules;
+
+// little endian, and a multiple of 8 bytes so the bitsets after it are aligned in a mapping
+typedef struct SnapshotHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width, height;
+	uint32_t nMines;
+	uint32_t flags;
+	uint32_t tilesLeft;
+	uint32_t minesFlagged;
+	uint64_t seed;
+	// of play, until now or until the game ended
+	uint64_t elapsedUs;
+	SnapshotRules rules;
+} SnapshotHeader;
+
+_Static_assert(sizeof(SnapshotHeader) % sizeof(uint64_t) == 0, "bitsets must stay aligned");
+
+static int CountBits(uint64_t word){
+#ifdef _MSC_VER
+	return (int) __popcnt64(word);
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+static uint64_t ReadWord(const uint8_t* at){
+	uint64_t word;
+	memcpy(&word, at, sizeof(word));
+	return word;
+}
+
+static void Snapshot_PackRules(const Neighborhood* nh, SnapshotRules* rules){
+	memset(rules, 0, sizeof(*rules));
+	rules->n = nh->n;
+	rules->wrap = nh->wrap;
+	for(int i = 0; i < nh->n; ++i){
+		rules->dx[i] = (int8_t) nh->dx[i];
+		rules->dy[i] = (int8_t) nh->dy[i];
+		rules->weight[i] = (int8_t) nh->weight[i];
+	}
+}
+
+bool State_SaveSnapshot(State* state, const wchar_t* path){
+	size_t nTiles = state->board.width * state->board.height;
+	size_t nWords = (nTiles + 63) / 64;
+	size_t size = sizeof(SnapshotHeader) + 3 * nWords * sizeof(uint64_t);
+	uint8_t* data = calloc(size, 1);
+
+	uint64_t elapsedUs = 0;
+	if(state->gameStarted){
+		uint64_t end = state->gameOver ? state->counterEnded : SDL_GetPerformanceCounter();
+		elapsedUs = (end - state->counterStarted) * 1000000 / SDL_GetPerformanceFrequency();
+	}
+
+	SnapshotHeader header = {
+		.magic = SNAPSHOT_MAGIC,
+		.version = SNAPSHOT_VERSION,
+		.width = (uint32_t) state->board.width,
+		.height = (uint32_t) state->board.height,
+		.nMines = (uint32_t) state->board.nMines,
+		.flags = (state->gameStarted ? SNAPSHOT_STARTED : 0)
+			| (state->gameOver ? SNAPSHOT_OVER : 0)
+			| (state->gameWon ? SNAPSHOT_WON : 0),
+		.tilesLeft = (uint32_t) state->board.tilesLeft,
+		.minesFlagged = (uint32_t) state->board.minesFlagged,
+		.seed = state->game.seed,
+		.elapsedUs = elapsedUs,
+	};
+	Snapshot_PackRules(&state->game.neighborhoodRule, &header.rules);
+	memcpy(data, &header, sizeof(header));
+
+	uint64_t* mines = (uint64_t*) (data + sizeof(header));
+	uint64_t* uncovered = mines + nWords;
+	uint64_t* flagged = uncovered + nWords;
+	for(size_t i = 0; i < nTiles; ++i){
+		TileState tileState = state->board.tiles[i].state;
+		uint64_t bit = (uint64_t) 1 << (i % 64);
+		if(tileState & TILE_STATE_MINE) mines[i / 64] |= bit;
+		if(tileState & TILE_STATE_UNCOVERED) uncovered[i / 64] |= bit;
+		if(tileState & TILE_STATE_FLAG) flagged[i / 64] |= bit;
+	}
+
+	// a half written file never replaces a good one
+	size_t pathLength = wcslen(path);
+	wchar_t* tempPath = malloc((pathLength + 5) * sizeof(*tempPath));
+	memcpy(tempPath, path, pathLength * sizeof(*tempPath));
+	memcpy(tempPath + pathLength, L".tmp", 5 * sizeof(*tempPath));
+
+	bool written = false;
+	FILE* file = _wfopen(tempPath, L"wb");
+	if(file != NULL){
+		written = fwrite(data, 1, size, file) == size;
+		written = fclose(file) == 0 && written;
+		if(written) written = MoveFileExW(tempPath, path, MOVEFILE_REPLACE_EXISTING);
+	}
+
+	if(!written) fprintf(stderr, "Could not write snapshot to \"%ls\"\n", path);
+	free(tempPath);
+	free(data);
+	return written;
+}
+
+static bool Snapshot_Invalid(const char* reason){
+	fprintf(stderr, "Could not load snapshot: %s\n", reason);
+	return false;
+}
+
+bool State_RestoreSnapshot(State* state, const void* data, size_t size){
+	SnapshotHeader header;
+	if(size < sizeof(header)) return Snapshot_Invalid("file too short");
+	memcpy(&header, data, sizeof(header));
+
+	if(header.magic != SNAPSHOT_MAGIC) return Snapshot_Invalid("not a snapshot");
+	if(header.version != SNAPSHOT_VERSION) return Snapshot_Invalid("unsupported version");
+
+	uint64_t nTiles = (uint64_t) header.width * header.height;
+	if(header.width == 0 || header.height == 0 || nTiles > INT32_MAX || header.nMines >= nTiles){
+		return Snapshot_Invalid("invalid board");
+	}
+
+	size_t nWords = (size_t) (nTiles + 63) / 64;
+	if(size != sizeof(header) + 3 * nWords * sizeof(uint64_t)) return Snapshot_Invalid("wrong size for its board");
+
+	SnapshotRules rules;
+	Snapshot_PackRules(&state->game.neighborhoodRule, &rules);
+	if(memcmp(&rules, &header.rules, sizeof(rules)) != 0) return Snapshot_Invalid("saved with a different game mode's rules");
+
+	bool started = header.flags & SNAPSHOT_STARTED;
+	bool over = header.flags & SNAPSHOT_OVER;
+	bool won = header.flags & SNAPSHOT_WON;
+	if((over && !started) || (won && !over)) return Snapshot_Invalid("inconsistent flags");
+
+	// counted first, so a bad file never touches the board
+	const uint8_t* mines = (const uint8_t*) data + sizeof(header);
+	const uint8_t* uncovered = mines + nWords * sizeof(uint64_t);
+	const uint8_t* flagged = uncovered + nWords * sizeof(uint64_t);
+	uint64_t nMines = 0, nUncovered = 0, nFlagged = 0;
+	bool overlap = false;
+	for(size_t w = 0; w < nWords; ++w){
+		uint64_t m = ReadWord(mines + w * 8), u = ReadWord(uncovered + w * 8), f = ReadWord(flagged + w * 8);
+		nMines += CountBits(m);
+		// a lost game's mine is uncovered, without counting as a tile cleared
+		nUncovered += CountBits(u & ~m);
+		nFlagged += CountBits(f);
+		overlap |= (u & f) != 0;
+	}
+	// bits past the last tile are never set, so the counts can't include them
+	uint64_t lastBits = nTiles % 64 == 0 ? 0 : ~(uint64_t) 0 << (nTiles % 64);
+	lastBits &= ReadWord(mines + (nWords - 1) * 8) | ReadWord(uncovered + (nWords - 1) * 8) | ReadWord(flagged + (nWords - 1) * 8);
+
+	if(
+		lastBits != 0
+		|| overlap
+		|| nMines != (started ? header.nMines : 0)
+		|| header.tilesLeft != nTiles - nUncovered
+		|| header.minesFlagged != nFlagged
+	){
+		return Snapshot_Invalid("counters don't match its tiles");
+	}
+
+	state->board.width = header.width;
+	state->board.height = header.height;
+	state->board.nMines = (int) header.nMines;
+	State_ResetBoard(state);
+
+	// each word covers the same 64 tiles in every bitset
+	Tile* tiles = state->board.tiles;
+	TileState initialized = started ? TILE_STATE_INITIALIZED : TILE_STATE_UNINITIALIZED;
+	for(size_t w = 0; w < nWords; ++w){
+		uint64_t m = ReadWord(mines + w * 8), u = ReadWord(uncovered + w * 8), f = ReadWord(flagged + w * 8);
+		size_t end = KET_MIN((w + 1) * 64, nTiles);
+		for(size_t i = w * 64; i < end; ++i){
+			tiles[i].state = (TileState) (
+				initialized
+				| (m & 1) * TILE_STATE_MINE
+				| (u & 1) * TILE_STATE_UNCOVERED
+				| (f & 1) * TILE_STATE_FLAG
+			);
+			m >>= 1;
+			u >>= 1;
+			f >>= 1;
+		}
+	}
+	if(started) Neighborhood_CountMines(&state->game.neighborhood, tiles, state->board.width, state->board.height);
+
+	state->board.tilesLeft = (int) header.tilesLeft;
+	state->board.minesFlagged = (int) header.minesFlagged;
+	state->game.seed = header.seed;
+	state->gameStarted = started;
+	state->gameOver = over;
+	state->gameWon = won;
+
+	// the clock picks up where it was saved
+	uint64_t elapsed = header.elapsedUs * SDL_GetPerformanceFrequency() / 1000000;
+	state->counterStarted = SDL_GetPerformanceCounter() - elapsed;
+	state->counterEnded = state->counterStarted + elapsed;
+
+	// moves made before it was saved weren't
+	History_Clear(state->history, state);
+	return true;
+}
+
+bool State_LoadSnapshot(State* state, const wchar_t* path){
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		fprintf(stderr, "Could not open snapshot \"%ls\"\n", path);
+		return false;
+	}
+
+	bool loaded = false;
+	LARGE_INTEGER size;
+	if(GetFileSizeEx(file, &size) && size.QuadPart > 0){
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(mapping != NULL){
+			const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if(view != NULL){
+				loaded = State_RestoreSnapshot(state, view, (size_t) size.QuadPart);
+				UnmapViewOfFile(view);
+			}
+			CloseHandle(mapping);
+		}
+	}
+	else{
+		fprintf(stderr, "Could not load snapshot: empty file\n");
+	}
+
+	CloseHandle(file);
+	return loaded;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wchar.h>
+
+struct State;
+
+// a game in progress as a header followed by three bitsets, one bit per tile:
+// mines, uncovered and flagged
+// numbers aren't stored, they're counted again on load, with the rules saved in the header
+// which have to match the current game mode's
+
+// written next to path first, then moved over it
+bool State_SaveSnapshot(struct State*, const wchar_t* path);
+
+// maps the file instead of reading it
+// returns false, leaving the board alone, if the file isn't a snapshot or its rules don't match
+bool State_LoadSnapshot(struct State*, const wchar_t* path);
+
+// data is a whole snapshot file
+bool State_RestoreSnapshot(struct State*, const void* data, size_t size);
@@ -4,15 +4,64 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "Matrix.h"
+#include "Patterns.h"
+#include "SolverCache.h"
+#include "Arena.h"
+#include "Trace.h"
 
 bool UpdateSurroundingTiles(SolveState* state, int x, int y);
 
+void SolveState_Reset(SolveState* state, State* game){
+	int nTiles = game->board.width * game->board.height;
+	int nWords = (nTiles + 63) / 64;
+	if(nTiles > state->capacity){
+		state->uncovered = realloc(state->uncovered, nWords * sizeof(*state->uncovered));
+		state->flagged = realloc(state->flagged, nWords * sizeof(*state->flagged));
+		state->steps = realloc(state->steps, nTiles * sizeof(*state->steps));
+		state->changes = realloc(state->changes, nTiles * sizeof(*state->changes));
+		state->capacity = nTiles;
+	}
+	if(state->arena.chunkSize == 0) Arena_Init(&state->arena, SOLVER_ARENA_CHUNK_SIZE);
+	memset(state->uncovered, 0, nWords * sizeof(*state->uncovered));
+	memset(state->flagged, 0, nWords * sizeof(*state->flagged));
+	state->nChanges = 0;
+
+	state->w = game->board.width;
+	state->h = game->board.height;
+	state->board = game->board.tiles;
+	state->neighborhood = &game->game.neighborhood;
+	state->nMinesLeft = game->board.nMines;
+	state->log = false;
+	state->hardest = SOLVE_TECHNIQUE_NONE;
+	state->step = 0;
+	state->onUncover = NULL;
+	state->onUncoverData = NULL;
+	state->cache = game->game.solverCache;
+}
+
+void SolveState_Free(SolveState* state){
+	free(state->uncovered);
+	free(state->flagged);
+	free(state->steps);
+	free(state->changes);
+	state->capacity = 0;
+	Arena_Free(&state->arena);
+}
+
+// sets the tile's bit and remembers when, for rollbacks
+static void SolveState_Mark(SolveState* state, uint64_t* bits, int index){
+	bits[index >> 6] |= (uint64_t) 1 << (index & 63);
+	state->steps[index] = state->step;
+	state->changes[state->nChanges++] = index;
+}
+
 bool FlagTileAtIndex(SolveState* state, int index){
-	if(state->tiles[index].flagged) return false;
+	if(SolveState_Flagged(state, index)) return false;
 	if(state->log) printf("Flagging %d %d\n", index % state->w, index / state->w);
-	state->tiles[index].flagged = true;
+	SolveState_Mark(state, state->flagged, index);
 	--state->nMinesLeft;
 	UpdateSurroundingTiles(state, index % state->w, index / state->w);
 	return true;
@@ -20,17 +69,17 @@ bool FlagTileAtIndex(SolveState* state, int index){
 
 bool ClearTile(SolveState* state, int x, int y) {
 	int index = x + y * state->w;
-	SolveStateTile* tile = &state->tiles[index];
 
-	if(tile->uncovered) return false;
+	if(SolveState_Uncovered(state, index)) return false;
 
-	tile->uncovered = true;
-	if(tile->surroundingMines == 0){
-		for(int newX = x - 1; newX <= x + 1; ++newX){
-			for(int newY = y - 1; newY <= y + 1; ++newY){
-				if((newX == x && newY == y) || newX < 0 || newY < 0 || newX >= state->w || newY >= state->h) continue;
-				ClearTile(state, newX, newY);
-			}
+	SolveState_Mark(state, state->uncovered, index);
+	if(state->onUncover != NULL) state->onUncover(state, index, state->onUncoverData);
+	if(SolveState_Number(state, index) == 0){
+		const Neighborhood* nh = state->neighborhood;
+		for(int i = 0; i < nh->n; ++i){
+			int newX, newY;
+			if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, i, &newX, &newY)) continue;
+			ClearTile(state, newX, newY);
 		}
 	}
 	return true;
@@ -48,63 +97,64 @@ int CountSurroundingTiles(SolveState* state, int x, int y, int includeFlagged, i
 
 bool ClearSurroundingTiles(SolveState* state, int x, int y) {
 	bool madeChanges = false;
-	SolveStateTile* tile = &state->tiles[x + y * state->w];
 
 	if(state->log) printf("Checking tiles around %d %d to clear...\n", x, y);
 
-	if(CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE) < tile->surroundingMines) return false;
+	if(CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE) < SolveState_Number(state, x + y * state->w)) return false;
 
 	if(state->log) printf("Clearing tiles around %d %d\n", x, y);
 
-	for(int newX = x - 1; newX <= x + 1; ++newX){
-		for(int newY = y - 1; newY <= y + 1; ++newY){
-			if((newX == x && newY == y) || newX < 0 || newY < 0 || newX >= state->w || newY >= state->h) continue;
-			SolveStateTile* newTile = &state->tiles[newX + newY * state->w];
-			if(newTile->flagged || newTile->uncovered) {
-				continue;
-			};
-			madeChanges = ClearTile(state, newX, newY) || madeChanges;
-			madeChanges = ClearSurroundingTiles(state, newX, newY) || madeChanges;
-		}
+	const Neighborhood* nh = state->neighborhood;
+	for(int i = 0; i < nh->n; ++i){
+		int newX, newY;
+		if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, i, &newX, &newY)) continue;
+		int newIndex = newX + newY * state->w;
+		if(SolveState_Flagged(state, newIndex) || SolveState_Uncovered(state, newIndex)) {
+			continue;
+		};
+		madeChanges = ClearTile(state, newX, newY) || madeChanges;
+		madeChanges = ClearSurroundingTiles(state, newX, newY) || madeChanges;
 	}
 	return madeChanges;
 }
 
 bool UpdateSurroundingTiles(SolveState* state, int x, int y) {
 	bool madeChanges = false;
-	SolveStateTile* tile = &state->tiles[x + y * state->w];
 
 	if(state->log) printf("Trying to update tiles around %d %d\n", x, y);
 
-	for(int newX = x - 1; newX <= x + 1; ++newX){
-		for(int newY = y - 1; newY <= y + 1; ++newY){
-			if((newX == x && newY == y) || newX < 0 || newY < 0 || newX >= state->w || newY >= state->h) continue;
+	// tiles whose numbers count this tile
+	const Neighborhood* nh = state->neighborhood;
+	for(int i = 0; i < nh->n; ++i){
+		int newX, newY;
+		if(!Neighborhood_Referrer(nh, state->w, state->h, x, y, i, &newX, &newY)) continue;
 
-			SolveStateTile* newTile = &state->tiles[newX + newY * state->w];
-			if(!newTile->uncovered) {
-				continue;
-			};
+		if(!SolveState_Uncovered(state, newX + newY * state->w)) {
+			continue;
+		};
 
-			ClearSurroundingTiles(state, newX, newY);
-		}
+		ClearSurroundingTiles(state, newX, newY);
 	}
 	return madeChanges;
 }
 
+// weighted by the neighborhood, so counting flags gives the number of mines accounted for
 int CountSurroundingTiles(SolveState* state, int x, int y, int includeFlagged, int includeUncovered) {
 	int n = 0;
-	for(int newX = x - 1; newX <= x + 1; ++newX){
-		for(int newY = y - 1; newY <= y + 1; ++newY){
-			if((newX == x && newY == y) || newX < 0 || newY < 0 || newX >= state->w || newY >= state->h) continue;
-			SolveStateTile* tile = &state->tiles[newX + newY * state->w];
-
-			if(includeFlagged == REQUIRE && !tile->flagged) continue;
-			if(includeFlagged == DISCLUDE && tile->flagged) continue;
-			if(includeUncovered == REQUIRE && !tile->uncovered) continue;
-			if(includeUncovered == DISCLUDE && tile->uncovered) continue;
-
-			++n;
-		}
+	const Neighborhood* nh = state->neighborhood;
+	for(int i = 0; i < nh->n; ++i){
+		int newX, newY;
+		if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, i, &newX, &newY)) continue;
+		int newIndex = newX + newY * state->w;
+		bool flagged = SolveState_Flagged(state, newIndex);
+		bool uncovered = SolveState_Uncovered(state, newIndex);
+
+		if(includeFlagged == REQUIRE && !flagged) continue;
+		if(includeFlagged == DISCLUDE && flagged) continue;
+		if(includeUncovered == REQUIRE && !uncovered) continue;
+		if(includeUncovered == DISCLUDE && uncovered) continue;
+
+		n += nh->weight[i];
 	}
 	return n;
 }
@@ -112,11 +162,11 @@ int CountSurroundingTiles(SolveState* state, int x, int y, int includeFlagged, i
 void PrintSolveState(SolveState* state){
 	for(int y = 0; y < state->h; ++y){
 		for(int x = 0; x < state->w; ++x){
-			SolveStateTile* tile = &state->tiles[x + y * state->w];
-			if(tile->uncovered){
-				printf("%c", '0' + tile->surroundingMines);
+			int index = x + y * state->w;
+			if(SolveState_Uncovered(state, index)){
+				printf("%c", '0' + SolveState_Number(state, index));
 			}
-			else if(tile->flagged){
+			else if(SolveState_Flagged(state, index)){
 				printf("x");
 			}
 			else{
@@ -129,6 +179,12 @@ void PrintSolveState(SolveState* state){
 }
 
 void SetInsert(int* set, size_t* size, int newValue) {
+	if(*size == 0){
+		set[0] = newValue;
+		*size = 1;
+		return;
+	}
+
 	int start = 0, end = *size - 1;
 	while(true){
 		int middle = (end + start)/2;
@@ -159,122 +215,163 @@ void SetInsert(int* set, size_t* size, int newValue) {
 	}
 }
 
-bool SolveIter(SolveState* state, bool phase2){
-	if(state->log) printf("===Phase%d===\n", phase2 ? 2 : 1);
-
-	if(state->log) PrintSolveState(state);
+// index of value in the sorted set, or -1
+int SetFind(const int* set, size_t size, int value) {
+	int start = 0, end = (int) size - 1;
+	while(start <= end){
+		int middle = (start + end)/2;
+		if(set[middle] < value) start = middle + 1;
+		else if(set[middle] > value) end = middle - 1;
+		else return middle;
+	}
+	return -1;
+}
 
+// a number whose mines are all flagged clears its other tiles,
+// and one with as many mines missing as covered tiles flags them all
+bool SolveIterSingle(SolveState* state){
 	bool madeChanges = false;
+	const Neighborhood* nh = state->neighborhood;
 
-	SolveStateTile* tiles = state->tiles;
+	for(int y = 0; y < state->h; ++y){
+		for(int x = 0; x < state->w; ++x){
+			int number = SolveState_Number(state, x + y * state->w);
+			if(!SolveState_Uncovered(state, x + y * state->w) || number == 0) continue;
 
-	// find unresolved tiles
-	size_t unresolvedTilesSize = 0;
-	size_t unresolvedTilesCap = 64;
-	int* unresolvedTiles = malloc(unresolvedTilesCap * sizeof(*unresolvedTiles));
+			int unknown = CountSurroundingTiles(state, x, y, DISCLUDE, DISCLUDE);
+			if(unknown == 0) continue;
 
-	if(state->log) printf("Finding unresolved tiles...\n");
-	for(int x = 0; x < state->w; ++x){
-		for(int y = 0; y < state->h; ++y){
-			int index = x + y * state->w;
+			int missing = number - CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE);
+			if(missing != 0 && missing != unknown) continue;
 
-			// if it has mines around it
-			if(tiles[index].uncovered && tiles[index].surroundingMines > 0){
-				// if we havent flagged all the mines around a tile
-				if(tiles[index].surroundingMines != CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE)) {
-					if(unresolvedTilesSize == unresolvedTilesCap){
-						unresolvedTilesCap *= 2;
-						unresolvedTiles = realloc(unresolvedTiles, sizeof(*unresolvedTiles) * unresolvedTilesCap);
-					}
-					SetInsert(unresolvedTiles, &unresolvedTilesSize, index);
-					if(state->log) printf("\tFound: %d %d\n", x, y);
-				}
+			for(int i = 0; i < nh->n; ++i){
+				int nx, ny;
+				if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, i, &nx, &ny)) continue;
+
+				int index = nx + ny * state->w;
+				if(SolveState_Uncovered(state, index) || SolveState_Flagged(state, index)) continue;
+
+				if(missing == 0) ClearTile(state, nx, ny);
+				else FlagTileAtIndex(state, index);
+				madeChanges = true;
 			}
 		}
 	}
 
+	if(madeChanges && state->log) printf("Single-cell rule made progress\n");
+	return madeChanges;
+}
 
-	// find candidate mine spots
-	size_t candidatesSize = 0;
-	size_t candidatesCap = 64;
-	int* candidates = malloc(candidatesCap * sizeof(*candidates));
-	if(state->log) printf("Finding candidate tiles...\n");
-	if(!phase2){
-		// for every tile
-		for(int i = 0; i < unresolvedTilesSize; ++i){
-			int index = unresolvedTiles[i];
-			int x = index % state->w;
-			int y = index / state->w;
-
-			for(int sx = x - 1; sx <= x + 1; ++sx){
-				for(int sy = y - 1; sy <= y + 1; ++sy){
-					if((sx == x && sy == y) || sx < 0 || sy < 0 || sx >= state->w || sy >= state->h) continue;
-					int sIndex = sx + sy * state->w;
-					if(!tiles[sIndex].uncovered && !tiles[sIndex].flagged) {
-						if(candidatesCap == candidatesSize){
-							candidatesCap *= 2;
-							candidates = realloc(candidates, candidatesCap * sizeof(*candidates));
-						}
-						SetInsert(candidates, &candidatesSize, sIndex);
-						if(state->log) printf("\tFound: %d %d\n", sx, sy);
-					}
-				}
-			}
+// covered tiles a number counts that aren't flagged, and how many mines it still needs
+// returns false if it counts more covered tiles than the pattern table knows about
+static bool GatherPatternTiles(SolveState* state, int index, int* tiles, int* nTiles, int* missing){
+	const Neighborhood* nh = state->neighborhood;
+	int x = index % state->w, y = index / state->w;
+
+	*nTiles = 0;
+	*missing = SolveState_Number(state, index);
+	for(int i = 0; i < nh->n; ++i){
+		int nx, ny;
+		if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, i, &nx, &ny)) continue;
+
+		int neighbor = nx + ny * state->w;
+		if(SolveState_Flagged(state, neighbor)) --*missing;
+		else if(!SolveState_Uncovered(state, neighbor)){
+			if(*nTiles == PATTERN_MAX_TILES) return false;
+			tiles[(*nTiles)++] = neighbor;
 		}
 	}
-	else {
-		// find candidate mine spots (all covered tiles)
-		// for every tile
-		for(int i = 0; i < state->w * state->h; ++i){
-			if(!state->tiles[i].uncovered && !state->tiles[i].flagged) {
-				if(candidatesCap == candidatesSize){
-					candidatesCap *= 2;
-					candidates = realloc(candidates, candidatesCap * sizeof(*candidates));
-				}
+	return *missing >= 0 && *missing <= PATTERN_MAX_TILES;
+}
 
-				candidates[candidatesSize++] = i;
-				if(state->log) printf("\tFound: %d %d\n", i % state->w, i / state->w);
-			}
-		}
+static bool ContainsTile(const int* tiles, int nTiles, int index){
+	for(int i = 0; i < nTiles; ++i){
+		if(tiles[i] == index) return true;
 	}
+	return false;
+}
 
-	// create matrix for rref
-	Matrix* mat = Matrix_New(unresolvedTilesSize + (phase2 ? 1 : 0), candidatesSize + 1);
+// clears or flags the tiles of one part of a pattern, per the table's result
+static bool ApplyPattern(SolveState* state, const int* tiles, int nTiles, const int* other, int nOther, bool shared, uint8_t safe, uint8_t mines){
+	if(!(safe || mines)) return false;
 
-	for(int r = 0; r < unresolvedTilesSize; ++r){
-		int unresolvedTileIndex = unresolvedTiles[r];
-		int ux = unresolvedTileIndex % state->w;
-		int uy = unresolvedTileIndex / state->w;
+	bool madeChanges = false;
+	for(int i = 0; i < nTiles; ++i){
+		if(ContainsTile(other, nOther, tiles[i]) != shared) continue;
 
-		for(int c = 0; c < candidatesSize; ++c){
-			int candidateIndex = candidates[c];
-			int cx = candidateIndex % state->w;
-			int cy = candidateIndex / state->w;
+		// an earlier part's flood fill may have reached it
+		if(SolveState_Uncovered(state, tiles[i]) || SolveState_Flagged(state, tiles[i])) continue;
 
-			if(abs(cx - ux) <= 1 && abs(cy - uy) <= 1){
-				*Matrix_Get(mat, r, c) = 1;
-			}
-		}
-		*Matrix_Get(mat, r, candidatesSize) = state->tiles[unresolvedTileIndex].surroundingMines - CountSurroundingTiles(state, ux, uy, REQUIRE, DISCLUDE);
+		if(safe) ClearTileAtIndex(state, tiles[i]);
+		else FlagTileAtIndex(state, tiles[i]);
+		madeChanges = true;
 	}
+	return madeChanges;
+}
 
-	if(phase2) {
-		// sum of all uncleared tiles must be equal to mines left
-		for(int c = 0; c < candidatesSize; ++c){
-			*Matrix_Get(mat, unresolvedTilesSize, c) = 1;
+// two numbers sharing covered tiles at a time, looked up in the pattern table
+// only for neighborhoods where every mine weighs 1
+bool SolveIterPatterns(SolveState* state){
+	const Neighborhood* nh = state->neighborhood;
+	for(int i = 0; i < nh->n; ++i){
+		if(nh->weight[i] != 1) return false;
+	}
+
+	bool madeChanges = false;
+	for(int index = 0; index < state->w * state->h; ++index){
+		if(!SolveState_Uncovered(state, index) || SolveState_Number(state, index) == 0) continue;
+
+		int first[PATTERN_MAX_TILES], nFirst, missingFirst;
+		if(!GatherPatternTiles(state, index, first, &nFirst, &missingFirst) || nFirst == 0) continue;
+
+		// every other number counting one of the same tiles
+		int seen[PATTERN_MAX_TILES * NEIGHBORHOOD_MAX_OFFSETS];
+		int nSeen = 0;
+		bool applied = false;
+		for(int t = 0; t < nFirst && !applied; ++t){
+			for(int i = 0; i < nh->n && !applied; ++i){
+				int rx, ry;
+				if(!Neighborhood_Referrer(nh, state->w, state->h, first[t] % state->w, first[t] / state->w, i, &rx, &ry)) continue;
+
+				int other = rx + ry * state->w;
+				// each pair once
+				if(other <= index || !SolveState_Uncovered(state, other) || ContainsTile(seen, nSeen, other)) continue;
+				seen[nSeen++] = other;
+
+				int second[PATTERN_MAX_TILES], nSecond, missingSecond;
+				if(!GatherPatternTiles(state, other, second, &nSecond, &missingSecond)) continue;
+
+				int nShared = 0;
+				for(int j = 0; j < nFirst; ++j){
+					nShared += ContainsTile(second, nSecond, first[j]);
+				}
+
+				uint8_t result = Patterns_Lookup(nFirst - nShared, nShared, nSecond - nShared, missingFirst, missingSecond);
+				if(result == 0) continue;
+
+				if(state->log) printf("Pattern between %d %d and %d %d\n", index % state->w, index / state->w, rx, ry);
+				applied = ApplyPattern(state, first, nFirst, second, nSecond, false, result & PATTERN_FIRST_SAFE, result & PATTERN_FIRST_MINES);
+				applied = ApplyPattern(state, first, nFirst, second, nSecond, true, result & PATTERN_SHARED_SAFE, result & PATTERN_SHARED_MINES) || applied;
+				applied = ApplyPattern(state, second, nSecond, first, nFirst, false, result & PATTERN_SECOND_SAFE, result & PATTERN_SECOND_MINES) || applied;
+			}
 		}
-		*Matrix_Get(mat, unresolvedTilesSize, candidatesSize) = state->nMinesLeft;
+		madeChanges = madeChanges || applied;
 	}
 
-	if(state->log) printf("Original matrix:\n");
-	if(state->log) Matrix_Print(mat);
+	return madeChanges;
+}
+
+// reduces mat and marks each column it proves a mine or safe
+// for each row, the upper bound is the sum of the positive entries and lower is sum of negative entries
+static void DeduceFromMatrix(Matrix* mat, SolverCacheResult* results, bool log){
+	if(log) printf("Original matrix:\n");
+	if(log) Matrix_Print(mat);
 
 	Matrix_RREF(mat);
 
-	if(state->log) printf("RREF matrix:\n");
-	if(state->log) Matrix_Print(mat);
+	if(log) printf("RREF matrix:\n");
+	if(log) Matrix_Print(mat);
 
-	// for each row, the upper bound is the sum of the positive entries and lower is sum of negative entries
 	for(int r = 0; r < mat->r; ++r){
 		int lowerBound = 0, upperBound = 0;
 		bool allSameSign = true;
@@ -296,39 +393,294 @@ bool SolveIter(SolveState* state, bool phase2){
 				}
 			}
 		}
-		if(state->log) printf("Bounds for row %d: L: %d, U: %d\n", r, lowerBound, upperBound);
+		if(log) printf("Bounds for row %d: L: %d, U: %d\n", r, lowerBound, upperBound);
 		int numMines = *Matrix_Get(mat, r, mat->c - 1);
 		// number of mines = lower bound -> all negative entries are mines
 		if(numMines == lowerBound){
 			for(int c = 0; c < mat->c - 1; ++c){
-				int v = *Matrix_Get(mat, r, c);
-				if(v < 0) {
-					madeChanges = true;
-					FlagTileAtIndex(state, candidates[c]);
-				}
+				if(*Matrix_Get(mat, r, c) < 0) results[c] = SOLVER_CACHE_MINE;
 			}
 		}
 		// number of mines = upper bound -> all positive entries are mines
 		else if(numMines == upperBound){
 			for(int c = 0; c < mat->c - 1; ++c){
-				int v = *Matrix_Get(mat, r, c);
-				if(v > 0) {
-					madeChanges = true;
-					FlagTileAtIndex(state, candidates[c]);
-				}
+				if(*Matrix_Get(mat, r, c) > 0) results[c] = SOLVER_CACHE_MINE;
 			}
 		}
 		if(numMines == 0 && allSameSign){
 			for(int c = 0; c < mat->c - 1; ++c){
-				int v = *Matrix_Get(mat, r, c);
-				if(v != 0) {
-					madeChanges = true;
-					ClearTileAtIndex(state, candidates[c]);
+				if(*Matrix_Get(mat, r, c) != 0) results[c] = SOLVER_CACHE_SAFE;
+			}
+		}
+	}
+}
+
+static int FindRow(int* parent, int r){
+	while(parent[r] != r){
+		parent[r] = parent[parent[r]];
+		r = parent[r];
+	}
+	return r;
+}
+
+static int CompareInts(const void* a, const void* b){
+	return *(const int*) a - *(const int*) b;
+}
+
+// numbers that share no candidates can't tell each other anything,
+// so each connected part of the frontier gets its own, much smaller, matrix
+// a part's signature is its equations with candidates numbered in board order,
+// equal signatures always reduce the same way so the result can come from state->cache
+static void SolveComponents(SolveState* state, const int* rows, int nRows, const int* candidates, int nCandidates, SolverCacheResult* results){
+	const Neighborhood* nh = state->neighborhood;
+
+	// each row's entries as candidate and weight
+	Arena* arena = &state->arena;
+	int* rowStart = Arena_Alloc(arena, (nRows + 1) * sizeof(*rowStart));
+	int* rowMissing = Arena_Alloc(arena, nRows * sizeof(*rowMissing));
+	int* entryColumn = Arena_Alloc(arena, nRows * nh->n * sizeof(*entryColumn));
+	int* entryWeight = Arena_Alloc(arena, nRows * nh->n * sizeof(*entryWeight));
+	int nEntries = 0;
+	for(int r = 0; r < nRows; ++r){
+		int x = rows[r] % state->w, y = rows[r] / state->w;
+		rowStart[r] = nEntries;
+		rowMissing[r] = SolveState_Number(state, rows[r]) - CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE);
+
+		for(int j = 0; j < nh->n; ++j){
+			int cx, cy;
+			if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, j, &cx, &cy)) continue;
+
+			int c = SetFind(candidates, nCandidates, cx + cy * state->w);
+			if(c == -1) continue;
+			entryColumn[nEntries] = c;
+			entryWeight[nEntries] = nh->weight[j];
+			++nEntries;
+		}
+	}
+	rowStart[nRows] = nEntries;
+
+	// rows sharing a candidate are in the same part
+	int* parent = Arena_Alloc(arena, nRows * sizeof(*parent));
+	int* columnRow = Arena_Alloc(arena, nCandidates * sizeof(*columnRow));
+	for(int r = 0; r < nRows; ++r) parent[r] = r;
+	for(int c = 0; c < nCandidates; ++c) columnRow[c] = -1;
+	for(int r = 0; r < nRows; ++r){
+		for(int e = rowStart[r]; e < rowStart[r + 1]; ++e){
+			int c = entryColumn[e];
+			if(columnRow[c] == -1) columnRow[c] = r;
+			else parent[FindRow(parent, r)] = FindRow(parent, columnRow[c]);
+		}
+	}
+
+	// rows grouped by part, in board order within each
+	int* partStart = Arena_Alloc(arena, (nRows + 1) * sizeof(*partStart));
+	int* partRows = Arena_Alloc(arena, nRows * sizeof(*partRows));
+	memset(partStart, 0, (nRows + 1) * sizeof(*partStart));
+	for(int r = 0; r < nRows; ++r) ++partStart[FindRow(parent, r) + 1];
+	for(int r = 0; r < nRows; ++r) partStart[r + 1] += partStart[r];
+	for(int r = 0; r < nRows; ++r) partRows[partStart[FindRow(parent, r)]++] = r;
+	// partStart[root] now points at the next part, shift back
+	for(int r = nRows; r > 0; --r) partStart[r] = partStart[r - 1];
+	partStart[0] = 0;
+
+	int* localColumn = columnRow;
+	for(int c = 0; c < nCandidates; ++c) localColumn[c] = -1;
+	int* columns = Arena_Alloc(arena, nCandidates * sizeof(*columns));
+	int* signature = Arena_Alloc(arena, (2 + nRows * 2 + nEntries * 2) * sizeof(*signature));
+	uint8_t* partResults = Arena_Alloc(arena, nCandidates);
+	SolverCacheResult* deduced = Arena_Alloc(arena, nCandidates * sizeof(*deduced));
+
+	for(int root = 0; root < nRows; ++root){
+		int first = partStart[root], last = partStart[root + 1];
+		if(first == last) continue;
+
+		int nColumns = 0;
+		for(int i = first; i < last; ++i){
+			int r = partRows[i];
+			for(int e = rowStart[r]; e < rowStart[r + 1]; ++e){
+				if(localColumn[entryColumn[e]] != -1) continue;
+				localColumn[entryColumn[e]] = 0;
+				columns[nColumns++] = entryColumn[e];
+			}
+		}
+		qsort(columns, nColumns, sizeof(*columns), CompareInts);
+		for(int i = 0; i < nColumns; ++i) localColumn[columns[i]] = i;
+
+		int length = 0;
+		signature[length++] = last - first;
+		signature[length++] = nColumns;
+		for(int i = first; i < last; ++i){
+			int r = partRows[i];
+			signature[length++] = rowMissing[r];
+			signature[length++] = rowStart[r + 1] - rowStart[r];
+			for(int e = rowStart[r]; e < rowStart[r + 1]; ++e){
+				signature[length++] = localColumn[entryColumn[e]];
+				signature[length++] = entryWeight[e];
+			}
+		}
+
+		const uint8_t* cached = state->cache != NULL ? SolverCache_Find(state->cache, signature, length) : NULL;
+		if(cached == NULL){
+			Matrix* mat = Matrix_NewInArena(arena, last - first, nColumns + 1);
+			for(int i = first; i < last; ++i){
+				int r = partRows[i];
+				for(int e = rowStart[r]; e < rowStart[r + 1]; ++e){
+					*Matrix_Get(mat, i - first, localColumn[entryColumn[e]]) += entryWeight[e];
+				}
+				*Matrix_Get(mat, i - first, nColumns) = rowMissing[r];
+			}
+
+			memset(deduced, 0, nColumns * sizeof(*deduced));
+			DeduceFromMatrix(mat, deduced, state->log);
+			for(int i = 0; i < nColumns; ++i) partResults[i] = deduced[i];
+
+			if(state->cache != NULL) SolverCache_Insert(state->cache, signature, length, partResults, nColumns);
+			cached = partResults;
+		}
+
+		for(int i = 0; i < nColumns; ++i){
+			results[columns[i]] = cached[i];
+			localColumn[columns[i]] = -1;
+		}
+	}
+
+}
+
+// single tile deductions, then patterns
+static bool SolveIterLocal(SolveState* state){
+	// run to a fixed point so a round of cheap deductions counts as one iteration
+	bool single = false;
+	while(SolveIterSingle(state)) single = true;
+
+	if(single){
+		state->hardest = KET_MAX(state->hardest, SOLVE_TECHNIQUE_SINGLE);
+		return true;
+	}
+
+	// most of what's left is local, RREF only gets what patterns can't do
+	if(SolveIterPatterns(state)){
+		state->hardest = KET_MAX(state->hardest, SOLVE_TECHNIQUE_PATTERN);
+		return true;
+	}
+	return false;
+}
+
+static bool SolveIterMatrix(SolveState* state, bool phase2){
+	if(state->log) printf("===Phase%d===\n", phase2 ? 2 : 1);
+
+	if(state->log) PrintSolveState(state);
+
+	bool madeChanges = false;
+
+	const Neighborhood* nh = state->neighborhood;
+	int nTiles = state->w * state->h;
+
+	// neither set can hold more than every tile
+	size_t unresolvedTilesSize = 0;
+	int* unresolvedTiles = Arena_Alloc(&state->arena, nTiles * sizeof(*unresolvedTiles));
+
+	if(state->log) printf("Finding unresolved tiles...\n");
+	for(int x = 0; x < state->w; ++x){
+		for(int y = 0; y < state->h; ++y){
+			int index = x + y * state->w;
+
+			// if it has mines around it
+			if(SolveState_Uncovered(state, index) && SolveState_Number(state, index) > 0){
+				// if we havent flagged all the mines around a tile
+				if(SolveState_Number(state, index) != CountSurroundingTiles(state, x, y, REQUIRE, DISCLUDE)) {
+					SetInsert(unresolvedTiles, &unresolvedTilesSize, index);
+					if(state->log) printf("\tFound: %d %d\n", x, y);
 				}
 			}
 		}
 	}
 
+
+	// find candidate mine spots
+	size_t candidatesSize = 0;
+	int* candidates = Arena_Alloc(&state->arena, nTiles * sizeof(*candidates));
+	if(state->log) printf("Finding candidate tiles...\n");
+	if(!phase2){
+		// for every tile
+		for(int i = 0; i < unresolvedTilesSize; ++i){
+			int index = unresolvedTiles[i];
+			int x = index % state->w;
+			int y = index / state->w;
+
+			for(int j = 0; j < nh->n; ++j){
+				int sx, sy;
+				if(!Neighborhood_Neighbor(nh, state->w, state->h, x, y, j, &sx, &sy)) continue;
+				int sIndex = sx + sy * state->w;
+				if(!SolveState_Uncovered(state, sIndex) && !SolveState_Flagged(state, sIndex)) {
+					SetInsert(candidates, &candidatesSize, sIndex);
+					if(state->log) printf("\tFound: %d %d\n", sx, sy);
+				}
+			}
+		}
+	}
+	else {
+		// find candidate mine spots (all covered tiles)
+		// for every tile
+		for(int i = 0; i < state->w * state->h; ++i){
+			if(!SolveState_Uncovered(state, i) && !SolveState_Flagged(state, i)) {
+				candidates[candidatesSize++] = i;
+				if(state->log) printf("\tFound: %d %d\n", i % state->w, i / state->w);
+			}
+		}
+	}
+
+	TRACE_ARG("unresolved", unresolvedTilesSize);
+	TRACE_ARG("candidates", candidatesSize);
+
+	SolverCacheResult* results = Arena_Alloc(&state->arena, candidatesSize * sizeof(*results));
+	memset(results, 0, candidatesSize * sizeof(*results));
+	if(phase2){
+		// the mines left tie every candidate together, so it's one big matrix
+		Matrix* mat = Matrix_NewInArena(&state->arena, unresolvedTilesSize + 1, candidatesSize + 1);
+
+		for(int r = 0; r < unresolvedTilesSize; ++r){
+			int unresolvedTileIndex = unresolvedTiles[r];
+			int ux = unresolvedTileIndex % state->w;
+			int uy = unresolvedTileIndex / state->w;
+
+			// coefficient of each candidate is its weight in this tile's number
+			for(int j = 0; j < nh->n; ++j){
+				int cx, cy;
+				if(!Neighborhood_Neighbor(nh, state->w, state->h, ux, uy, j, &cx, &cy)) continue;
+
+				int c = SetFind(candidates, candidatesSize, cx + cy * state->w);
+				if(c != -1){
+					*Matrix_Get(mat, r, c) += nh->weight[j];
+				}
+			}
+			*Matrix_Get(mat, r, candidatesSize) = SolveState_Number(state, unresolvedTileIndex) - CountSurroundingTiles(state, ux, uy, REQUIRE, DISCLUDE);
+		}
+
+		// sum of all uncleared tiles must be equal to mines left
+		for(int c = 0; c < candidatesSize; ++c){
+			*Matrix_Get(mat, unresolvedTilesSize, c) = 1;
+		}
+		*Matrix_Get(mat, unresolvedTilesSize, candidatesSize) = state->nMinesLeft;
+
+		DeduceFromMatrix(mat, results, state->log);
+	}
+	else{
+		SolveComponents(state, unresolvedTiles, unresolvedTilesSize, candidates, candidatesSize, results);
+	}
+
+	for(int c = 0; c < candidatesSize; ++c){
+		if(results[c] == SOLVER_CACHE_MINE){
+			madeChanges = true;
+			FlagTileAtIndex(state, candidates[c]);
+		}
+	}
+	for(int c = 0; c < candidatesSize; ++c){
+		if(results[c] == SOLVER_CACHE_SAFE){
+			madeChanges = true;
+			ClearTileAtIndex(state, candidates[c]);
+		}
+	}
+
 	if(state->log) printf("Flag result:\n");
 	if(state->log) PrintSolveState(state);
 
@@ -342,8 +694,7 @@ bool SolveIter(SolveState* state, bool phase2){
 			for(int i = 0; i < state->w * state->h; ++i){
 				int x = i % state->w;
 				int y = i / state->w;
-				SolveStateTile* tile = &state->tiles[i];
-				if(!tile->flagged && !tile->uncovered){
+				if(!SolveState_Flagged(state, i) && !SolveState_Uncovered(state, i)){
 					clearedTiles = ClearTile(state, x, y) || clearedTiles;
 				}
 			}
@@ -365,14 +716,81 @@ bool SolveIter(SolveState* state, bool phase2){
 	if(state->log) printf("Clear result:\n");
 	if(state->log) PrintSolveState(state);
 
-	Matrix_Free(mat);
+	if(madeChanges){
+		SolveTechnique technique = phase2 ? SOLVE_TECHNIQUE_GLOBAL : SOLVE_TECHNIQUE_RREF;
+		state->hardest = KET_MAX(state->hardest, technique);
+	}
+	return madeChanges;
+}
 
-	free(candidates);
-	free(unresolvedTiles);
+bool SolveIter(SolveState* state, bool phase2){
+	// nothing from the last iteration is still in use
+	Arena_Reset(&state->arena);
+	++state->step;
+	++state->nIters;
+	SDL_AtomicAdd(&state->progress, 1);
+
+	TRACE_BEGIN("SolveIter");
+	TRACE_ARG("step", state->step);
+	TRACE_ARG("phase2", phase2);
+	bool madeChanges = (!phase2 && SolveIterLocal(state)) || SolveIterMatrix(state, phase2);
+	TRACE_ARG("madeChanges", madeChanges);
+	TRACE_END();
 
 	return madeChanges;
 }
 
+void EstimateMineRisk(SolveState* state, float* risk){
+	int nCovered = 0;
+	for(int i = 0; i < state->w * state->h; ++i){
+		if(!SolveState_Uncovered(state, i) && !SolveState_Flagged(state, i)) ++nCovered;
+	}
+	float density = nCovered > 0 ? (float) state->nMinesLeft / nCovered : 0;
+
+	const Neighborhood* nh = state->neighborhood;
+	for(int y = 0; y < state->h; ++y){
+		for(int x = 0; x < state->w; ++x){
+			int index = x + y * state->w;
+			if(SolveState_Uncovered(state, index) || SolveState_Flagged(state, index)){
+				risk[index] = SOLVER_NO_RISK;
+				continue;
+			}
+
+			bool frontier = false;
+			float frontierRisk = 0;
+			for(int i = 0; i < nh->n; ++i){
+				int nx, ny;
+				if(!Neighborhood_Referrer(nh, state->w, state->h, x, y, i, &nx, &ny)) continue;
+				if(!SolveState_Uncovered(state, nx + ny * state->w)) continue;
+
+				int missing = SolveState_Number(state, nx + ny * state->w) - CountSurroundingTiles(state, nx, ny, REQUIRE, DISCLUDE);
+				int unknown = CountSurroundingTiles(state, nx, ny, DISCLUDE, DISCLUDE);
+				if(unknown == 0) continue;
+
+				frontier = true;
+				frontierRisk = KET_MAX(frontierRisk, (float) missing / unknown);
+			}
+
+			risk[index] = frontier ? frontierRisk : density;
+		}
+	}
+}
+
+void RollbackSolveState(SolveState* state, int step){
+	// changes are in step order, so the ones to undo are all at the end
+	while(state->nChanges > 0){
+		int index = state->changes[state->nChanges - 1];
+		if(state->steps[index] <= step) break;
+
+		uint64_t bit = (uint64_t) 1 << (index & 63);
+		if(state->flagged[index >> 6] & bit) ++state->nMinesLeft;
+		state->uncovered[index >> 6] &= ~bit;
+		state->flagged[index >> 6] &= ~bit;
+		--state->nChanges;
+	}
+	state->step = KET_MAX(step, 0);
+}
+
 // https://stackoverflow.com/questions/466204/rounding-up-to-next-power-of-2
 int RoundUpToPowerOf2(int value){
 	unsigned int v = value;
@@ -390,7 +808,9 @@ int RoundUpToPowerOf2(int value){
 
 bool HasSolution(SolveParams* params, TilePosition** unsolvableTilesOut, size_t* unsolvableTilesLenOut) {
 	SolveState* state = params->state;
-	SolveStateTile* tiles = state->tiles;
+	uint64_t start = SDL_GetPerformanceCounter();
+	TRACE_BEGIN("HasSolution");
+	TRACE_ARG("firstStep", state->step);
 
 	if(params->tileClicked.x != -1){
 		ClearTile(state, params->tileClicked.x, params->tileClicked.y);
@@ -408,37 +828,35 @@ bool HasSolution(SolveParams* params, TilePosition** unsolvableTilesOut, size_t*
 		if(params->maxIters > 0 && i++ > params->maxIters) break;
 	}
 
+	TRACE_ARG("lastStep", state->step);
+	TRACE_ARG("minesLeft", state->nMinesLeft);
+	TRACE_END();
+	state->solveCounter += SDL_GetPerformanceCounter() - start;
+
 	if(state->nMinesLeft != 0){
 		// unsolvable
 		// fill unsolvableTiles
-		size_t cap = (size_t) RoundUpToPowerOf2(state->nMinesLeft * 2);
-		if(cap < 16) cap = 16;
 		size_t len = 0;
-		TilePosition* unsolvableTiles = malloc(cap * sizeof(*unsolvableTiles));
+		TilePosition* unsolvableTiles = Arena_Alloc(&state->arena, state->w * state->h * sizeof(*unsolvableTiles));
 		for(int y = 0; y < state->h; ++y){
 			for(int x = 0; x < state->w; ++x){
 				int index = x + y * state->w;
-				if(!tiles[index].uncovered) {
-					// check if the tile is near an uncovered tile
+				if(!SolveState_Uncovered(state, index)) {
+					// check if the tile is counted by an uncovered tile
 					bool nearUncovered = false;
-					for(int i = 0; i < 9; ++i){
-						int dx = i % 3 - 2;
-						int dy = i % 3 - 2;
-						int newX = x + dx, newY = y + dy;
-						if((dx == 0 && dy == 0) || newX < 0 || newY < 0 || newX >= state->w || newY >= state->h){
+					const Neighborhood* nh = state->neighborhood;
+					for(int i = 0; i < nh->n; ++i){
+						int newX, newY;
+						if(!Neighborhood_Referrer(nh, state->w, state->h, x, y, i, &newX, &newY)){
 							continue;
 						}
-						if(state->tiles[newX + state->w * newY].uncovered) {
+						if(SolveState_Uncovered(state, newX + state->w * newY)) {
 							nearUncovered = true;
 							break;
 						}
 					}
 
 					if(nearUncovered){
-						if(len >= cap){
-							cap *= 2;
-							unsolvableTiles = realloc(unsolvableTiles, cap * sizeof(*unsolvableTiles));
-						}
 						unsolvableTiles[len++] = (TilePosition) { x, y };
 					}
 				}
@@ -6,22 +6,73 @@
 #include <stdint.h>
 
 #include "State.h"
+#include "Arena.h"
 
 // https://massaioli.wordpress.com/2013/01/12/solving-minesweeper-with-matricies/
 
-typedef struct SolveStateTile {
-	bool uncovered;
-	bool flagged;
-	uint8_t surroundingMines;
-} SolveStateTile;
-
+// what the solver knows about a board, laid over the board itself
+// numbers are read straight from the board's tiles, only once the solver has proven a tile safe
+// uncovered and flagged are the solver's own, one bit per tile
 typedef struct SolveState {
 	int w, h;
-	SolveStateTile* tiles;
+	Tile* board;
+	uint64_t* uncovered;
+	uint64_t* flagged;
+	// solver step that uncovered or flagged each tile
+	int* steps;
+	// every tile uncovered or flagged, oldest first, so a rollback only visits what it undoes
+	int* changes;
+	int nChanges;
+	// tiles the buffers above have room for, they're kept from one board to the next
+	int capacity;
+
+	const Neighborhood* neighborhood;
 	int nMinesLeft;
 	bool log;
+
+	// hardest technique any SolveIter so far needed to make progress
+	SolveTechnique hardest;
+
+	// 0 for the first click, then incremented by each SolveIter
+	int step;
+	// SolveIter calls over the state's lifetime, unlike step it's never reset or rolled back
+	uint64_t nIters;
+	// nIters for other threads to read while the solver runs, wraps around
+	SDL_atomic_t progress;
+	// performance counter ticks spent in HasSolution over the state's lifetime
+	uint64_t solveCounter;
+
+	// called as a tile gets uncovered, before its number is read
+	// lets a generator decide what a number counts only once the solver reaches it, may be NULL
+	void (*onUncover)(struct SolveState*, int index, void* data);
+	void* onUncoverData;
+
+	// remembers what RREF deduced for each part of the frontier, may be NULL
+	struct SolverCache* cache;
+
+	// temporaries of a single SolveIter, reset as the next one starts
+	// its highWater is the most any iteration needed
+	Arena arena;
 } SolveState;
 
+static inline bool SolveState_Uncovered(const SolveState* state, int index){
+	return state->uncovered[index >> 6] >> (index & 63) & 1;
+}
+
+static inline bool SolveState_Flagged(const SolveState* state, int index){
+	return state->flagged[index >> 6] >> (index & 63) & 1;
+}
+
+static inline int SolveState_Number(const SolveState* state, int index){
+	return state->board[index].surroundingMines;
+}
+
+// points the solver at the state's board with nothing uncovered or flagged yet,
+// with every mine left and no hooks, using the state's solver cache
+// only allocates if the board has more tiles than any board before
+void SolveState_Reset(SolveState*, State*);
+void SolveState_Free(SolveState*);
+
 typedef struct SolveParams {
 	SolveState* state;
 	struct {
@@ -32,5 +83,25 @@ typedef struct SolveParams {
 
 void PrintSolveState(SolveState* state);
 
-// make sure to free unsolvable tiles once you're done
+// uncovers a tile proven safe, and everything around it if it's a 0
+// returns false if it already was
+bool ClearTile(SolveState*, int x, int y);
+
+// one round of deductions: flags certain mines and clears certain safe tiles
+// the single-cell rule is tried first, then pairs of numbers through the pattern table, RREF only if neither finds anything
+// phase2 also uses the total number of mines left
+// returns false if nothing could be deduced
+bool SolveIter(SolveState*, bool phase2);
+
+// rough chance of each tile being a mine, for when nothing can be deduced
+// a tile counted by numbers takes the worst ratio of missing mines to covered tiles among them,
+// any other covered tile gets the density of mines left
+// uncovered and flagged tiles get SOLVER_NO_RISK
+void EstimateMineRisk(SolveState*, float* risk);
+
+// forgets every deduction made after step, so solving can resume from there
+// deductions up to step only depend on numbers of tiles uncovered by then
+void RollbackSolveState(SolveState*, int step);
+
+// unsolvable tiles live in the state's arena, they stay valid until its next SolveIter
 bool HasSolution(SolveParams*, TilePosition** unsolvableTiles, size_t* unsolvableTilesLen);
\ No newline at end of file
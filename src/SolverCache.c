@@ -0,0 +1,121 @@
+#include "SolverCache.h"
+#include "Constants.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SolverCacheEntry {
+	uint64_t hash;
+	// into signatures and results, -1 if the slot is empty
+	int signature;
+	int length;
+	int results;
+} SolverCacheEntry;
+
+struct SolverCache {
+	SolverCacheEntry entries[SOLVER_CACHE_CAPACITY];
+	int nEntries;
+
+	int* signatures;
+	int signaturesSize;
+
+	uint8_t* results;
+	int resultsSize;
+
+	uint64_t nHits, nMisses;
+};
+
+// FNV-1a
+static uint64_t SolverCache_Hash(const int* signature, int length){
+	uint64_t hash = 0xcbf29ce484222325;
+	for(int i = 0; i < length; ++i){
+		hash ^= (uint32_t) signature[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+static void SolverCache_Clear(SolverCache* cache){
+	for(int i = 0; i < SOLVER_CACHE_CAPACITY; ++i){
+		cache->entries[i].signature = -1;
+	}
+	cache->nEntries = 0;
+	cache->signaturesSize = 0;
+	cache->resultsSize = 0;
+}
+
+SolverCache* SolverCache_New(void){
+	SolverCache* cache = malloc(sizeof(*cache));
+	cache->signatures = malloc(SOLVER_CACHE_MAX_INTS * sizeof(*cache->signatures));
+	cache->results = malloc(SOLVER_CACHE_MAX_INTS * sizeof(*cache->results));
+	cache->nHits = 0;
+	cache->nMisses = 0;
+	SolverCache_Clear(cache);
+	return cache;
+}
+
+void SolverCache_Free(SolverCache* cache){
+	free(cache->signatures);
+	free(cache->results);
+	free(cache);
+}
+
+// slot holding the signature, or the empty slot it would go in
+static SolverCacheEntry* SolverCache_Slot(SolverCache* cache, const int* signature, int length, uint64_t hash){
+	for(int i = hash & (SOLVER_CACHE_CAPACITY - 1);; i = (i + 1) & (SOLVER_CACHE_CAPACITY - 1)){
+		SolverCacheEntry* entry = &cache->entries[i];
+		if(entry->signature == -1) return entry;
+		if(
+			entry->hash == hash && entry->length == length
+			&& memcmp(&cache->signatures[entry->signature], signature, length * sizeof(*signature)) == 0
+		){
+			return entry;
+		}
+	}
+}
+
+const uint8_t* SolverCache_Find(SolverCache* cache, const int* signature, int length){
+	SolverCacheEntry* entry = SolverCache_Slot(cache, signature, length, SolverCache_Hash(signature, length));
+	if(entry->signature == -1){
+		++cache->nMisses;
+		return NULL;
+	}
+
+	++cache->nHits;
+	return &cache->results[entry->results];
+}
+
+void SolverCache_Insert(SolverCache* cache, const int* signature, int length, const uint8_t* results, int nResults){
+	// too big to ever fit
+	if(length > SOLVER_CACHE_MAX_INTS || nResults > SOLVER_CACHE_MAX_INTS) return;
+
+	// keep probes short, and start over rather than tracking what's least used
+	if(
+		cache->nEntries >= SOLVER_CACHE_CAPACITY / 2
+		|| cache->signaturesSize + length > SOLVER_CACHE_MAX_INTS
+		|| cache->resultsSize + nResults > SOLVER_CACHE_MAX_INTS
+	){
+		SolverCache_Clear(cache);
+	}
+
+	uint64_t hash = SolverCache_Hash(signature, length);
+	SolverCacheEntry* entry = SolverCache_Slot(cache, signature, length, hash);
+	if(entry->signature != -1) return;
+
+	*entry = (SolverCacheEntry) {
+		.hash = hash,
+		.signature = cache->signaturesSize,
+		.length = length,
+		.results = cache->resultsSize,
+	};
+	memcpy(&cache->signatures[cache->signaturesSize], signature, length * sizeof(*signature));
+	memcpy(&cache->results[cache->resultsSize], results, nResults);
+	cache->signaturesSize += length;
+	cache->resultsSize += nResults;
+	++cache->nEntries;
+}
+
+void SolverCache_GetStats(const SolverCache* cache, uint64_t* nHits, uint64_t* nMisses){
+	*nHits = cache->nHits;
+	*nMisses = cache->nMisses;
+}
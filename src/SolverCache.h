@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// what RREF deduced for each independent part of the frontier, keyed by that part's equations
+// the same equations come up again and again: a part the last deduction didn't touch, a rollback solving the same numbers again,
+// or the same shape elsewhere on this board or the next one
+// a cache belongs to one thread, it's emptied whenever it fills up
+
+typedef enum SolverCacheResult {
+	SOLVER_CACHE_UNKNOWN,
+	SOLVER_CACHE_MINE,
+	SOLVER_CACHE_SAFE,
+} SolverCacheResult;
+
+typedef struct SolverCache SolverCache;
+
+SolverCache* SolverCache_New(void);
+void SolverCache_Free(SolverCache*);
+
+// signature: the part's equations in canonical order, see SolveIter
+// returns one SolverCacheResult per column, NULL if it isn't cached
+const uint8_t* SolverCache_Find(SolverCache*, const int* signature, int length);
+void SolverCache_Insert(SolverCache*, const int* signature, int length, const uint8_t* results, int nResults);
+
+void SolverCache_GetStats(const SolverCache*, uint64_t* nHits, uint64_t* nMisses);
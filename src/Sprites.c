@@ -0,0 +1,63 @@
+#include "Sprites.h"
+#include "State.h"
+
+#include "EmbeddedImages.h"
+
+#define SPRITE(member, x, y, w, h) { offsetof(State, images.tilesheet.member), { x, y, w, h } }
+
+// tilesheet layout, shared by every theme
+static const SpriteRect spriteRects[] = {
+	SPRITE(normal, 0, 39, 16, 16),
+	SPRITE(pressed, 0, 23, 16, 16),
+	SPRITE(flaged, 16, 39, 16, 16),
+	SPRITE(mine, 64, 39, 16, 16),
+	SPRITE(mineRed, 32, 39, 16, 16),
+
+	SPRITE(tileDigit[0], 16, 23, 16, 16),
+	SPRITE(tileDigit[1], 32, 23, 16, 16),
+	SPRITE(tileDigit[2], 48, 23, 16, 16),
+	SPRITE(tileDigit[3], 64, 23, 16, 16),
+	SPRITE(tileDigit[4], 80, 23, 16, 16),
+	SPRITE(tileDigit[5], 96, 23, 16, 16),
+	SPRITE(tileDigit[6], 112, 23, 16, 16),
+	SPRITE(tileDigit[7], 128, 23, 16, 16),
+
+	SPRITE(smiley.normal, 1, 56, 24, 24),
+	SPRITE(smiley.pressed, 27, 56, 24, 24),
+	SPRITE(smiley.win, 105, 56, 24, 24),
+	SPRITE(smiley.lose, 79, 56, 24, 24),
+	SPRITE(smiley.surprise, 53, 56, 24, 24),
+
+	SPRITE(digit[0], 0, 0, 13, 23),
+	SPRITE(digit[1], 13, 0, 13, 23),
+	SPRITE(digit[2], 26, 0, 13, 23),
+	SPRITE(digit[3], 39, 0, 13, 23),
+	SPRITE(digit[4], 52, 0, 13, 23),
+	SPRITE(digit[5], 65, 0, 13, 23),
+	SPRITE(digit[6], 78, 0, 13, 23),
+	SPRITE(digit[7], 91, 0, 13, 23),
+	SPRITE(digit[8], 104, 0, 13, 23),
+	SPRITE(digit[9], 117, 0, 13, 23),
+	SPRITE(digitMinus, 130, 0, 13, 23),
+
+	SPRITE(border.ul, 0, 81, 10, 10),
+	SPRITE(border.ur, 10, 81, 10, 10),
+	SPRITE(border.dl, 20, 81, 10, 10),
+	SPRITE(border.dr, 30, 81, 10, 10),
+	SPRITE(border.ud, 40, 81, 10, 10),
+	SPRITE(border.urd, 56, 81, 10, 10),
+	SPRITE(border.uld, 66, 81, 10, 10),
+	SPRITE(border.lr, 134, 39, 10, 32),
+
+	SPRITE(background, 134, 81, 10, 10),
+};
+
+const SpriteTable SPRITES = {
+	.rects = spriteRects,
+	.nRects = sizeof(spriteRects)/sizeof(*spriteRects),
+
+	.tilesheets = {
+		.original = { EMBEDDED_TILESHEET_ORIGINAL, EMBEDDED_TILESHEET_ORIGINAL_SIZE },
+		.cute = { EMBEDDED_TILESHEET_CUTE, EMBEDDED_TILESHEET_CUTE_SIZE },
+	},
+};
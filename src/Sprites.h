@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <SDL.h>
+
+// where a tilesheet rect lives, as an offset into State
+typedef struct SpriteRect {
+	size_t stateOffset;
+	SDL_Rect rect;
+} SpriteRect;
+
+typedef struct EmbeddedImage {
+	const unsigned char* data;
+	size_t size;
+} EmbeddedImage;
+
+// everything State_LoadResources needs, compiled into the executable
+typedef struct SpriteTable {
+	const SpriteRect* rects;
+	size_t nRects;
+
+	struct {
+		EmbeddedImage original;
+		EmbeddedImage cute;
+	} tilesheets;
+} SpriteTable;
+
+extern const SpriteTable SPRITES;
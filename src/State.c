@@ -5,6 +5,7 @@
 #include "Resources.h"
 
 #include <stdio.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
@@ -14,6 +15,15 @@
 
 #include "Lua.h"
 #include "Solver.h"
+#include "Timeline.h"
+#include "Replay.h"
+#include "Repair.h"
+#include "Construct.h"
+#include "SolverCache.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Watchdog.h"
+#include "History.h"
 
 bool State_StartGame(State* state, int tileX, int tileY);
 
@@ -69,17 +79,27 @@ bool State_Init(State* state){
 
 	state->shouldQuit = false;
 
+	Neighborhood_InitMoore(&state->game.neighborhoodRule);
+	state->game.neighborhood = state->game.neighborhoodRule;
+	DifficultyBand_Init(&state->game.band);
+	state->game.solverCache = SolverCache_New();
+	state->game.solveState = calloc(1, sizeof(SolveState));
+
 	HRESULT hr = CoInitializeEx(NULL, 0);
 	if(FAILED(hr)){
 		fprintf(stderr, "Could not initialize COM.");
 		return false;
 	}
+	state->com.init = true;
+
+	state->history = History_New();
 
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0){
+	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0){
 		fprintf(stderr, "Could not init SDL.");
 		return false;
 	}
 	state->sdl.init = true;
+	Timeline_Mark("SDL initialized");
 
 	int sdlImageFlags = IMG_INIT_PNG;
 	if(!(IMG_Init(sdlImageFlags) & sdlImageFlags)){
@@ -112,11 +132,13 @@ bool State_Init(State* state){
 		fprintf(stderr, "Could not create renderer.");
 		return false;
 	}
+	Timeline_Mark("Window and renderer created");
 
 	State_InitBoard(state);
 	State_InitLayout(state);
 
 	State_LoadResources(state);
+	Timeline_Mark("Resources loaded");
 
 	state->mouse.tileHoverX = -1;
 	state->mouse.tileHoverY = -1;
@@ -127,6 +149,26 @@ bool State_Init(State* state){
 	return true;
 }
 
+bool State_InitHeadless(State* state){
+	memset(state, 0, sizeof(*state));
+
+	state->shouldQuit = false;
+
+	Neighborhood_InitMoore(&state->game.neighborhoodRule);
+	state->game.neighborhood = state->game.neighborhoodRule;
+	DifficultyBand_Init(&state->game.band);
+	state->game.solverCache = SolverCache_New();
+	state->game.solveState = calloc(1, sizeof(SolveState));
+
+	State_InitBoard(state);
+	State_InitLayout(state);
+
+	state->mouse.tileHoverX = -1;
+	state->mouse.tileHoverY = -1;
+
+	return true;
+}
+
 void State_InitBoard(State* state){
 	state->board.width = BOARD_WIDTH_MEDIUM;
 	state->board.height = BOARD_HEIGHT_MEDIUM;
@@ -157,9 +199,18 @@ void State_CreateBoard(State* state){
 
 	state->board.tilesLeft = nTiles;
 	state->board.minesFlagged = 0;
+	++state->board.generation;
+	Neighborhood_Fit(&state->game.neighborhood, &state->game.neighborhoodRule, state->board.width, state->board.height);
 
 	state->gameStarted = false;
 	state->gameOver = false;
+
+	History_Clear(state->history, state);
+}
+
+void State_SetNeighborhood(State* state, const Neighborhood* rule){
+	state->game.neighborhoodRule = *rule;
+	Neighborhood_Fit(&state->game.neighborhood, rule, state->board.width, state->board.height);
 }
 
 void State_DestroyBoard(State* state){
@@ -171,149 +222,23 @@ void State_ResetBoard(State* state){
 	State_DestroyBoard(state);
 	State_CreateBoard(state);
 
-	int windowWidth, windowHeight;
-	SDL_GetWindowSizeInPixels(state->sdl.window, &windowWidth, &windowHeight);
-	State_RecalculateLayout(state, windowWidth, windowHeight);
-}
-
-void State_GenerateFlagsDefault(State* state);
-
-/**
- * @param solveStateTilesBuffer Buffer to be used for solve state to hold tiles
- * @param problematicTiles Tiles that could not be solved
- */
-bool State_HasSolution(State* state, SolveStateTile* solveStateTilesBuffer, int tileX, int tileY, TilePosition** problematicTiles, size_t* nProblematicTiles){
-	for(int i = 0; i < state->board.width * state->board.height; ++i){
-		solveStateTilesBuffer[i].flagged = state->board.tiles[i].state & TILE_STATE_FLAG;
-		solveStateTilesBuffer[i].uncovered = state->board.tiles[i].state & TILE_STATE_UNCOVERED;
-		solveStateTilesBuffer[i].surroundingMines = state->board.tiles[i].surroundingMines;
+	int windowWidth = state->layoutSize.width, windowHeight = state->layoutSize.height;
+	if(state->sdl.window != NULL){
+		SDL_GetWindowSizeInPixels(state->sdl.window, &windowWidth, &windowHeight);
 	}
-
-	SolveState solveState = {
-		.w = state->board.width,
-		.h = state->board.height,
-		.nMinesLeft = state->board.nMines - state->board.minesFlagged,
-		.tiles = solveStateTilesBuffer,
-		.log = false,
-	};
-
-	SolveParams solveParams = {
-		.state = &solveState,
-		.tileClicked = { tileX, tileY },
-		.maxIters = state->board.nMines / 2,
-	};
-
-	return HasSolution(&solveParams, problematicTiles, nProblematicTiles);
-}
-
-bool State_EnsureSolvableDefault(State* state, int tileX, int tileY){
-	SolveStateTile* sstBuffer = malloc(state->board.width * state->board.height * sizeof(*sstBuffer));
-
-	TilePosition* problematicTiles;
-	size_t nProblematicTiles;
-	bool hasSolution = State_HasSolution(state, sstBuffer, tileX, tileY, &problematicTiles, &nProblematicTiles);
-
-	TilePosition* candidateBuffer = malloc((SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1) * (SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1) * sizeof(*candidateBuffer));
-
-	int nPerturbations = 0;
-	while(!hasSolution && problematicTiles && nPerturbations++ < SOLVER_MAX_PERTURBATIONS){
-		// printf("Perturbation: %d\n", nPerturbations);
-		// Perturb problematic tiles
-
-		// iterate problematic tiles
-		for(int i = 0; i < nProblematicTiles; ++i){
-			TilePosition tilePosition = problematicTiles[i];
-			int x = tilePosition.x, y = tilePosition.y;
-			Tile* tile = &state->board.tiles[x + y * state->board.width];
-
-			// if its a mine, relocate
-			if(tile->state & TILE_STATE_MINE){
-				// count potential surrounding tiles
-				int nCandidates = 0;
-				for(int j = 0; j < (SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1) * (SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1); ++j){
-					int dx = j % (SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1) - SOLVER_MAX_PERTURBATION_DISTANCE;
-					int dy = j / (SOLVER_MAX_PERTURBATION_DISTANCE * 2 + 1) - SOLVER_MAX_PERTURBATION_DISTANCE;
-
-					if(abs(dx) < SOLVER_MIN_PERTURBATION_DISTANCE || abs(dy) < SOLVER_MIN_PERTURBATION_DISTANCE) continue;
-
-					int newX = x + dx;
-					int newY = y + dy;
-					if(
-						newX < 0 || newX >= state->board.width
-						|| newY < 0 || newY >= state->board.height
-						|| newX > tileX - BOARD_CLICK_SAFE_AREA && newX < tileX + BOARD_CLICK_SAFE_AREA
-						|| newY > tileY - BOARD_CLICK_SAFE_AREA && newY < tileX + BOARD_CLICK_SAFE_AREA
-					){
-						continue;
-					}
-
-					// dont move to where there's already a mine
-					if(state->board.tiles[newX + newY * state->board.width].state & TILE_STATE_MINE) continue;
-
-					bool isProblematic = false;
-					// dont move to a problematic tile
-					for(int k = 0; k < nProblematicTiles; ++k){
-						if(problematicTiles[k].x == x + dx && problematicTiles[k].y == y + dy) {
-							isProblematic = true;
-							break;
-						}
-					}
-					if(isProblematic) continue;
-
-					candidateBuffer[nCandidates++] = (TilePosition) { .x = newX, .y = newY };
-				}
-
-				if(nCandidates != 0){
-					int positionIndex = (int)((double) rand() / (RAND_MAX + 1) * nCandidates);
-					TilePosition position = candidateBuffer[positionIndex];
-					state->board.tiles[position.x + position.y * state->board.width].state |= TILE_STATE_MINE;
-					state->board.tiles[x + y * state->board.width].state &= ~TILE_STATE_MINE;
-				}
-			}
-		}
-
-		free(problematicTiles);
-
-		// recalculate flags
-		State_GenerateFlagsDefault(state);
-		hasSolution = State_HasSolution(state, sstBuffer, tileX, tileY, &problematicTiles, &nProblematicTiles);
-	}
-
-	free(candidateBuffer);
-
-	free(sstBuffer);
-	if(problematicTiles) free(problematicTiles);
-
-	return hasSolution;
+	State_RecalculateLayout(state, windowWidth, windowHeight);
 }
 
 void State_GenerateFlagsDefault(State* state){
 	// generate adjacent mine counts
 	// also set init flag
-	for(int tx = 0; tx < state->board.width; ++tx){
-		for(int ty = 0; ty < state->board.height; ++ty){
-			int index = tx + ty * state->board.width;
-			int minesSurroundingTile = 0;
-
-			for(int x = tx - 1; x <= tx + 1; ++x){
-				for(int y = ty - 1; y <= ty + 1; ++y){
-					if(x < 0 || x >= state->board.width || y < 0 || y >= state->board.height) {
-						continue;
-					}
-					if(state->board.tiles[x + y * state->board.width].state & TILE_STATE_MINE) {
-						++minesSurroundingTile;
-					}
-				}
-
-				state->board.tiles[index].surroundingMines = minesSurroundingTile;
-
-				state->board.tiles[index].state |= TILE_STATE_INITIALIZED;
-			}
-		}
-	}
+	Neighborhood_CountMines(&state->game.neighborhood, state->board.tiles, state->board.width, state->board.height);
 }
 
 void State_GenerateMinesDefault(State* state, int tileX, int tileY){
+	TRACE_BEGIN("State_GenerateMinesDefault");
+	TRACE_ARG("mines", state->board.nMines);
+
 	// generate mines
 	int nTiles = state->board.width * state->board.height;
 	int tilesLeft = nTiles - (BOARD_CLICK_SAFE_AREA * 2 + 1) * (BOARD_CLICK_SAFE_AREA * 2 + 1);
@@ -330,7 +255,7 @@ void State_GenerateMinesDefault(State* state, int tileX, int tileY){
 			}
 
 			float probability = (float)(minesLeft) / (tilesLeft--);
-			if((float)rand() / RAND_MAX < probability){
+			if(Random_Float(&state->game.random) < probability){
 				state->board.tiles[x + y * state->board.width].state |= TILE_STATE_MINE;
 				minesLeft -= 1;
 			}
@@ -341,55 +266,296 @@ void State_GenerateMinesDefault(State* state, int tileX, int tileY){
 
 		if(minesLeft == 0) break;
 	}
+
+	TRACE_END();
+}
+
+// a band search samples candidate boards on several threads
+// candidate i is always generated from the same seed, and the lowest matching i wins,
+// so the board only depends on the game's seed, not on thread timing
+typedef struct BandSearch {
+	const State* state;
+	int tileX, tileY;
+
+	SDL_atomic_t nextCandidate;
+	// lowest matching candidate so far, workers stop claiming candidates past it
+	SDL_atomic_t bestMatch;
+
+	SDL_mutex* mutex;
+	Tile* matchTiles;
+	BoardScore matchScore;
+	// lowest solvable candidate, used if nothing matches
+	int fallback;
+	Tile* fallbackTiles;
+	BoardScore fallbackScore;
+
+	// what every worker's solver went through, added up once it's done
+	uint64_t nIters;
+	uint64_t solveCounter;
+} BandSearch;
+
+// generates candidate i into tiles, returns false if it isn't solvable
+static bool State_GenerateCandidate(const State* state, Tile* tiles, SolverCache* cache, SolveState* solveState, int i, int tileX, int tileY, BoardScore* score){
+	// only what generation reads
+	State candidate;
+	memset(&candidate, 0, sizeof(candidate));
+	candidate.board.width = state->board.width;
+	candidate.board.height = state->board.height;
+	candidate.board.nMines = state->board.nMines;
+	candidate.board.tiles = tiles;
+	candidate.game.neighborhood = state->game.neighborhood;
+	candidate.game.solverCache = cache;
+	candidate.game.solveState = solveState;
+	Random_Seed(&candidate.game.random, state->game.seed + i);
+
+	State_ClearBoard(&candidate);
+	if(!State_ConstructBoard(&candidate, tileX, tileY, GENERATOR_MAX_MOVES, &score->technique)) return false;
+
+	Difficulty_Score(&state->game.neighborhood, tiles, state->board.width, state->board.height, score);
+	return true;
 }
 
-void State_CreateGameDefault(State* state, int tileX, int tileY){
-	State_GenerateMinesDefault(state, tileX, tileY);
-	State_GenerateFlagsDefault(state);
+static int BandSearchThread(void* data){
+	BandSearch* search = data;
+	const State* state = search->state;
+	size_t nTiles = state->board.width * state->board.height;
+
+	Tile* tiles = malloc(nTiles * sizeof(*tiles));
+	// candidates of one search share most of their shapes
+	SolverCache* cache = SolverCache_New();
+	SolveState solveState = { 0 };
+
+	while(true){
+		int i = SDL_AtomicAdd(&search->nextCandidate, 1);
+		if(i >= DIFFICULTY_BAND_MAX_CANDIDATES || i > SDL_AtomicGet(&search->bestMatch)) break;
+
+		BoardScore score = { 0 };
+		if(!State_GenerateCandidate(state, tiles, cache, &solveState, i, search->tileX, search->tileY, &score)) continue;
+
+		bool matches = DifficultyBand_Contains(&state->game.band, &score);
 
-	if(!State_EnsureSolvableDefault(state, tileX, tileY)){
-		State_ClearBoard(state);
-		State_CreateGameDefault(state, tileX, tileY);
+		SDL_LockMutex(search->mutex);
+		if(matches && i < SDL_AtomicGet(&search->bestMatch)){
+			memcpy(search->matchTiles, tiles, nTiles * sizeof(*tiles));
+			search->matchScore = score;
+			SDL_AtomicSet(&search->bestMatch, i);
+		}
+		else if(!matches && i < search->fallback){
+			memcpy(search->fallbackTiles, tiles, nTiles * sizeof(*tiles));
+			search->fallbackScore = score;
+			search->fallback = i;
+		}
+		SDL_UnlockMutex(search->mutex);
 	}
+
+	SDL_LockMutex(search->mutex);
+	search->nIters += solveState.nIters;
+	search->solveCounter += solveState.solveCounter;
+	SDL_UnlockMutex(search->mutex);
+
+	SolveState_Free(&solveState);
+	SolverCache_Free(cache);
+	free(tiles);
+	return 0;
+}
+
+// returns false if no candidate was solvable, the board is left untouched then
+static bool State_CreateGameInBand(State* state, int tileX, int tileY){
+	size_t nTiles = state->board.width * state->board.height;
+
+	BandSearch search = {
+		.state = state,
+		.tileX = tileX,
+		.tileY = tileY,
+		.mutex = SDL_CreateMutex(),
+		.matchTiles = malloc(nTiles * sizeof(Tile)),
+		.fallback = INT_MAX,
+		.fallbackTiles = malloc(nTiles * sizeof(Tile)),
+	};
+	SDL_AtomicSet(&search.nextCandidate, 0);
+	SDL_AtomicSet(&search.bestMatch, INT_MAX);
+
+	int nThreads = state->game.band.nThreads > 0 ? state->game.band.nThreads : SDL_GetCPUCount();
+	if(nThreads <= 1){
+		BandSearchThread(&search);
+	}
+	else{
+		SDL_Thread** threads = malloc(nThreads * sizeof(*threads));
+		for(int i = 0; i < nThreads; ++i){
+			threads[i] = SDL_CreateThread(BandSearchThread, "BandSearch", &search);
+		}
+		for(int i = 0; i < nThreads; ++i){
+			SDL_WaitThread(threads[i], NULL);
+		}
+		free(threads);
+	}
+
+	// every candidate before the one picked was thrown away
+	bool found = true;
+	if(SDL_AtomicGet(&search.bestMatch) != INT_MAX){
+		memcpy(state->board.tiles, search.matchTiles, nTiles * sizeof(Tile));
+		state->board.score = search.matchScore;
+		state->board.nGeneratorRestarts += SDL_AtomicGet(&search.bestMatch);
+	}
+	else if(search.fallback != INT_MAX){
+#ifdef KET_DEBUG
+		printf("No board in the difficulty band after %d candidates\n", DIFFICULTY_BAND_MAX_CANDIDATES);
+#endif
+		memcpy(state->board.tiles, search.fallbackTiles, nTiles * sizeof(Tile));
+		state->board.score = search.fallbackScore;
+		state->board.nGeneratorRestarts += DIFFICULTY_BAND_MAX_CANDIDATES;
+	}
+	else{
+		found = false;
+	}
+
+	state->board.nBandIters += search.nIters;
+	state->board.bandSolveCounter += search.solveCounter;
+
+	free(search.matchTiles);
+	free(search.fallbackTiles);
+	SDL_DestroyMutex(search.mutex);
+	return found;
+}
+
+bool State_CreateGameDefault(State* state, int tileX, int tileY){
+	uint64_t start = SDL_GetPerformanceCounter();
+	if(state->game.band.enabled){
+		bool found = State_CreateGameInBand(state, tileX, tileY);
+		PerfHud_RecordPhase(&state->perfHud, GENERATION_PHASE_BAND, start);
+		if(found) return true;
+	}
+
+	start = SDL_GetPerformanceCounter();
+	bool constructed = State_ConstructBoard(state, tileX, tileY, GENERATOR_MAX_MOVES, &state->board.score.technique);
+	PerfHud_RecordPhase(&state->perfHud, GENERATION_PHASE_CONSTRUCT, start);
+	if(constructed) return true;
+
+	++state->board.nGeneratorRestarts;
+	start = SDL_GetPerformanceCounter();
+	int nBoards = State_GenerateSolvableBoard(state, tileX, tileY, GENERATOR_MAX_REPAIRS);
+	PerfHud_RecordPhase(&state->perfHud, GENERATION_PHASE_REPAIR, start);
+	return nBoards > 0;
 }
 
 bool State_CreateGameCustom(State* state, int tileX, int tileY){
-	return State_Lua_GenerateBoard(state, tileX, tileY);
+	uint64_t start = SDL_GetPerformanceCounter();
+	bool created = State_Lua_GenerateBoard(state, tileX, tileY);
+	PerfHud_RecordPhase(&state->perfHud, GENERATION_PHASE_LUA, start);
+	return created;
 }
 
 // tileX,Y is the tile clicked to start the game
 // we must guarentee that there are no mines within 3x3 of that tile
 bool State_CreateGame(State* state, int tileX, int tileY){
+	memset(state->perfHud.generationPhases, 0, sizeof(state->perfHud.generationPhases));
+	uint64_t nIters = state->game.solveState->nIters;
+	uint64_t solveCounter = state->game.solveState->solveCounter;
+	uint64_t start = SDL_GetPerformanceCounter();
+	state->board.nGeneratorMoves = 0;
+	state->board.nGeneratorRestarts = 0;
+	state->board.nBandIters = 0;
+	state->board.bandSolveCounter = 0;
+
+	bool created;
 	if(state->game.mode == GAMEMODE_DEFAULT){
-		State_CreateGameDefault(state, tileX, tileY);
-		return true;
+		created = State_CreateGameDefault(state, tileX, tileY);
 	}
 	else {
-		return State_CreateGameCustom(state, tileX, tileY);
+		created = State_CreateGameCustom(state, tileX, tileY);
+	}
+
+	if(state->game.mode != GAMEMODE_DEFAULT){
+		state->board.score.technique = SOLVE_TECHNIQUE_NONE;
 	}
+
+	if(created){
+		uint64_t scoreStart = SDL_GetPerformanceCounter();
+		Difficulty_Score(
+			&state->game.neighborhood,
+			state->board.tiles,
+			state->board.width,
+			state->board.height,
+			&state->board.score
+		);
+		PerfHud_RecordPhase(&state->perfHud, GENERATION_PHASE_SCORE, scoreStart);
+	}
+
+	state->perfHud.generationIters = state->game.solveState->nIters - nIters + state->board.nBandIters;
+
+	if(created && state->metrics != NULL){
+		uint64_t frequency = SDL_GetPerformanceFrequency();
+		uint64_t generationUs = (SDL_GetPerformanceCounter() - start) * 1000000 / frequency;
+		uint64_t solverCounter = state->game.solveState->solveCounter - solveCounter + state->board.bandSolveCounter;
+		uint64_t solverUs = solverCounter * 1000000 / frequency;
+		uint64_t values[] = {
+			[METRIC_GENERATION] = generationUs,
+			[METRIC_SOLVER] = solverUs,
+			[METRIC_MOVES] = state->board.nGeneratorMoves,
+			[METRIC_RESTARTS] = state->board.nGeneratorRestarts,
+		};
+		for(int metric = METRIC_GENERATION; metric <= METRIC_RESTARTS; ++metric){
+			Metrics_Record(
+				state->metrics,
+				metric,
+				state->board.width,
+				state->board.height,
+				state->board.nMines,
+				state->game.mode != GAMEMODE_DEFAULT,
+				values[metric]
+			);
+		}
+	}
+	return created;
 }
 
 bool State_StartGame(State* state, int tileX, int tileY){
-	srand(time(NULL));
-
-	if(State_CreateGame(state, tileX, tileY)){
-		state->ticksStarted = SDL_GetTicks64();
-		state->gameStarted = true;
-		return true;
+	if(state->game.hasPendingSeed){
+		state->game.seed = state->game.pendingSeed;
+		state->game.hasPendingSeed = false;
 	}
 	else{
-		return false;
+		state->game.seed = (uint64_t) time(NULL) ^ SDL_GetPerformanceCounter();
+	}
+	Random_Seed(&state->game.random, state->game.seed);
+	State_RecordGameStart(state, tileX, tileY);
+	Watchdog_SetBoard(
+		state->watchdog,
+		(int) state->board.width,
+		(int) state->board.height,
+		state->board.nMines,
+		state->game.mode != GAMEMODE_DEFAULT,
+		state->game.seed
+	);
+	WatchdogPhase phase = Watchdog_SetPhase(state->watchdog, WATCHDOG_PHASE_GENERATION);
+
+	TRACE_BEGIN("State_StartGame");
+	TRACE_ARG("width", state->board.width);
+	TRACE_ARG("height", state->board.height);
+	TRACE_ARG("mines", state->board.nMines);
+
+	bool created = State_CreateGame(state, tileX, tileY);
+	if(created){
+		state->counterStarted = SDL_GetPerformanceCounter();
+		state->gameStarted = true;
+		// undo stops at the generated board, before the click that generated it
+		History_Clear(state->history, state);
 	}
+
+	TRACE_ARG("created", created);
+	TRACE_END();
+	Watchdog_SetPhase(state->watchdog, phase);
+	return created;
 }
 
 void State_LoseGame(State* state){
-	state->ticksEnded = SDL_GetTicks64();
+	state->counterEnded = SDL_GetPerformanceCounter();
 	state->gameOver = true;
 	state->gameWon = false;
 }
 
 void State_WinGame(State* state){
-	state->ticksEnded = SDL_GetTicks64();
+	state->counterEnded = SDL_GetPerformanceCounter();
 	state->gameOver = true;
 	state->gameWon = true;
 }
@@ -402,18 +568,19 @@ void State_UncoverTile(State* state, int tileX, int tileY){
 
 	--state->board.tilesLeft;
 	tile->state |= TILE_STATE_UNCOVERED;
+	History_RecordUncover(state->history, index);
 
 	uint8_t surroundingMines = state->board.tiles[index].surroundingMines;
 	if(surroundingMines == 0){
-		for(int x = tileX - 1; x <= tileX + 1; ++x){
-			for(int y = tileY - 1; y <= tileY + 1; ++y){
-				if((x == tileX && y == tileY) || x < 0 || x >= state->board.width || y < 0 || y >= state->board.height) {
-					continue;
-				}
+		const Neighborhood* nh = &state->game.neighborhood;
+		for(int i = 0; i < nh->n; ++i){
+			int x, y;
+			if(!Neighborhood_Neighbor(nh, state->board.width, state->board.height, tileX, tileY, i, &x, &y)) {
+				continue;
+			}
 
-				if(!(state->board.tiles[x + y * state->board.width].state & TILE_STATE_UNCOVERED)){
-					State_UncoverTile(state, x, y);
-				}
+			if(!(state->board.tiles[x + y * state->board.width].state & TILE_STATE_UNCOVERED)){
+				State_UncoverTile(state, x, y);
 			}
 		}
 	}
@@ -424,9 +591,14 @@ void State_FlagTile(State* state, int tileX, int tileY) {
 
 	Tile* tile = &state->board.tiles[tileIndex];
 	if(!(tile->state & TILE_STATE_UNCOVERED)) {
+		History_BeginMove(state->history, state);
+
 		// toggle flag
 		tile->state ^= TILE_STATE_FLAG;
 		state->board.minesFlagged += (tile->state & TILE_STATE_FLAG) ? 1 : -1;
+
+		History_RecordFlag(state->history, tileIndex);
+		History_EndMove(state->history, state);
 	}
 }
 
@@ -442,8 +614,11 @@ void State_ClickTile(State* state, int tileX, int tileY) {
 		if(!State_StartGame(state, tileX, tileY)) return;
 	}
 
+	History_BeginMove(state->history, state);
+
 	if(tile->state & TILE_STATE_MINE) {
 		tile->state |= TILE_STATE_UNCOVERED;
+		History_RecordMine(state->history, tileIndex);
 		State_LoseGame(state);
 	}
 	else {
@@ -453,13 +628,76 @@ void State_ClickTile(State* state, int tileX, int tileY) {
 	if(state->board.tilesLeft == state->board.nMines){
 		State_WinGame(state);
 	}
+
+	History_EndMove(state->history, state);
 }
 
 void State_ClickSmiley(State* state){
 	State_ResetBoard(state);
 }
 
-void State_HandleEvent(State* state, SDL_Event* event){
+// remembers when an input arrived, until the present that shows it
+static void State_AddPendingInput(State* state, SDL_Event* event, uint64_t arrived){
+	InputKind kind;
+	switch(event->type){
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			kind = INPUT_KIND_BUTTON;
+			break;
+		case SDL_MOUSEMOTION:
+			kind = INPUT_KIND_MOTION;
+			break;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			kind = INPUT_KIND_KEY;
+			break;
+		default:
+			return;
+	}
+
+	// headless states never present
+	if(state->sdl.renderer == NULL || state->latency.nPending == LATENCY_MAX_PENDING) return;
+
+	state->latency.pendingArrivals[state->latency.nPending] = arrived;
+	state->latency.pendingKinds[state->latency.nPending] = kind;
+	++state->latency.nPending;
+}
+
+static void State_RecordLatency(State* state, uint64_t presented){
+	uint64_t frequency = SDL_GetPerformanceFrequency();
+	for(int i = 0; i < state->latency.nPending; ++i){
+		uint64_t us = (presented - state->latency.pendingArrivals[i]) * 1000000 / frequency;
+		Histogram_Record(&state->latency.histograms[state->latency.pendingKinds[i]], us);
+	}
+	state->latency.nPending = 0;
+}
+
+void State_PrintLatency(State* state){
+	const char* names[INPUT_KIND_COUNT] = { "button", "motion", "key" };
+
+	printf("Input to present latency:\n");
+	for(int i = 0; i < INPUT_KIND_COUNT; ++i){
+		Histogram* histogram = &state->latency.histograms[i];
+		if(histogram->n == 0) continue;
+
+		printf(
+			"\t%-6s  p50 %.3f ms  p99 %.3f ms  max %.3f ms  mean %.3f ms  (%llu inputs)\n",
+			names[i],
+			Histogram_Percentile(histogram, 0.5) / 1000.0,
+			Histogram_Percentile(histogram, 0.99) / 1000.0,
+			histogram->max / 1000.0,
+			Histogram_Mean(histogram) / 1000.0,
+			(unsigned long long) histogram->n
+		);
+	}
+}
+
+void State_HandleEvent(State* state, SDL_Event* event, uint64_t arrived){
+	TRACE_BEGIN("State_HandleEvent");
+	TRACE_ARG("type", event->type);
+
+	State_AddPendingInput(state, event, arrived);
+
 	switch(event->type){
 		case SDL_WINDOWEVENT: {
 			switch(event->window.event){
@@ -560,6 +798,30 @@ void State_HandleEvent(State* state, SDL_Event* event){
 			break;
 		}
 
+		case SDL_KEYDOWN: {
+			if(event->key.repeat) break;
+
+			if(event->key.keysym.sym == SDLK_F3){
+				state->perfHud.visible = !state->perfHud.visible;
+			}
+			else if(event->key.keysym.sym == SDLK_F12 && state->tracePath != NULL){
+				Trace_Dump(state->tracePath);
+			}
+			else if(event->key.keysym.sym == SDLK_z && (event->key.keysym.mod & KMOD_CTRL)){
+				State_Undo(state);
+			}
+			else if(event->key.keysym.sym == SDLK_y && (event->key.keysym.mod & KMOD_CTRL)){
+				State_Redo(state);
+			}
+			else if(event->key.keysym.sym == SDLK_HOME){
+				State_SeekMove(state, 0);
+			}
+			else if(event->key.keysym.sym == SDLK_END){
+				State_SeekMove(state, History_GetMoveCount(state->history));
+			}
+			break;
+		}
+
 		case SDL_SYSWMEVENT: {
 			UINT msg = event->syswm.msg->msg.win.msg;
 			LPARAM lParam = event->syswm.msg->msg.win.lParam;
@@ -568,14 +830,70 @@ void State_HandleEvent(State* state, SDL_Event* event){
 
 			if(msg == WM_COMMAND && HIWORD(wParam) == 0){
 				WORD id = LOWORD(wParam);
+				uint32_t generation = state->board.generation;
 				State_HandleMenuEvent(state, hwnd, id);
+
+				// menu commands aren't recorded, only the boards they create
+				if(state->board.generation != generation) State_RecordBoard(state);
 			}
 			break;
 		}
 	}
+
+	State_RecordEvent(state, event);
+	TRACE_END();
+}
+
+// every sprite goes through here, so the perf HUD can count draw calls
+void State_RenderSprite(State* state, const SDL_Rect* src, const SDL_FRect* dst){
+	SDL_RenderCopyF(state->sdl.renderer, state->images.tilesheet.texture, src, dst);
+	++state->perfHud.nDrawCalls;
 }
 
 void State_Update(State* state){
+	TRACE_BEGIN("State_Update");
+	PerfHud_BeginFrame(&state->perfHud);
+	if(state->metrics != NULL){
+		if(state->perfHud.nFrames > 0){
+			Metrics_Record(
+				state->metrics,
+				METRIC_FRAME,
+				state->board.width,
+				state->board.height,
+				state->board.nMines,
+				state->game.mode != GAMEMODE_DEFAULT,
+				state->perfHud.frameTimes[(state->perfHud.nFrames - 1) % PERF_HUD_N_FRAMES]
+			);
+		}
+		Metrics_Poll(state->metrics);
+	}
+	State_PollCustomTheme(state);
+
+	State_Draw(state);
+
+#ifdef KET_DEBUG
+	//DrawLayoutOutlineV2(state);
+#endif
+
+	State_DrawPerfHud(state);
+
+	SDL_RenderPresent(state->sdl.renderer);
+	State_RecordLatency(state, SDL_GetPerformanceCounter());
+	PerfHud_EndFrame(&state->perfHud);
+	if(!state->drewFirstFrame){
+		state->drewFirstFrame = true;
+		SDL_ShowWindow(state->sdl.window);
+
+		Timeline_Mark("First frame presented");
+#ifdef KET_DEBUG
+		Timeline_Print();
+#endif
+	}
+
+	TRACE_END();
+}
+
+void State_Draw(State* state){
 	SDL_SetRenderDrawColor(
 		state->sdl.renderer,
 		state->backgroundColor.r,
@@ -612,12 +930,7 @@ void State_Update(State* state){
 		}
 	}
 
-	SDL_RenderCopyF(
-		state->sdl.renderer,
-		state->images.tilesheet.texture,
-		&smileyRect,
-		pFRect
-	);
+	State_RenderSprite(state, &smileyRect, pFRect);
 
 
 
@@ -628,20 +941,10 @@ void State_Update(State* state){
 	int place = 100;
 	for(int i = 0; i < 3; ++i){
 		if(minesLeft < 0 && i == 0){
-			SDL_RenderCopyF(
-				state->sdl.renderer,
-				state->images.tilesheet.texture,
-				&state->images.tilesheet.digitMinus,
-				&fRect
-			);
+			State_RenderSprite(state, &state->images.tilesheet.digitMinus, &fRect);
 		}
 		else {
-			SDL_RenderCopyF(
-				state->sdl.renderer,
-				state->images.tilesheet.texture,
-				&state->images.tilesheet.digit[(abs(minesLeft) / place) % 10],
-				&fRect
-			);
+			State_RenderSprite(state, &state->images.tilesheet.digit[(abs(minesLeft) / place) % 10], &fRect);
 		}
 
 		place /= 10;
@@ -654,10 +957,10 @@ void State_Update(State* state){
 
 	uint64_t time;
 	if(state->gameOver){
-		time = (state->ticksEnded - state->ticksStarted)/1000;
+		time = (state->counterEnded - state->counterStarted) / SDL_GetPerformanceFrequency();
 	}
 	else if (state->gameStarted){
-		time = (SDL_GetTicks64() - state->ticksStarted)/1000;
+		time = (SDL_GetPerformanceCounter() - state->counterStarted) / SDL_GetPerformanceFrequency();
 	}
 	else{
 		time = 0;
@@ -665,12 +968,7 @@ void State_Update(State* state){
 
 	place = 100;
 	for(int i = 0; i < 3; ++i){
-		SDL_RenderCopyF(
-			state->sdl.renderer,
-			state->images.tilesheet.texture,
-			&state->images.tilesheet.digit[(time / place) % 10],
-			&fRect
-		);
+		State_RenderSprite(state, &state->images.tilesheet.digit[(time / place) % 10], &fRect);
 
 		place /= 10;
 		fRect.x += fRect.w;
@@ -711,12 +1009,8 @@ void State_Update(State* state){
 			}
 		}
 
-		SDL_RenderCopyF(
-			state->sdl.renderer,
-			state->images.tilesheet.texture,
-			tilesheetRect,
-			pFRect
-		);
+		State_RenderSprite(state, tilesheetRect, pFRect);
+		++state->perfHud.nTilesDrawn;
 	}
 
 	struct Border {
@@ -746,27 +1040,21 @@ void State_Update(State* state){
 	// draw borders
 	for (int i = 0; i < sizeof(borders)/sizeof(*borders); ++i){
 		struct Border* border = &borders[i];
-		SDL_RenderCopyF(
-			state->sdl.renderer,
-			state->images.tilesheet.texture,
-			border->src,
-			border->dst
-		);
+		State_RenderSprite(state, border->src, border->dst);
 	}
+}
 
+void State_Destroy(State* state){
+	// it reads the solve state
+	if(state->watchdog) Watchdog_Stop(state->watchdog);
 
-#ifdef KET_DEBUG
-	//DrawLayoutOutlineV2(state);
-#endif
+	History_Free(state->history);
 
-	SDL_RenderPresent(state->sdl.renderer);
-	if(!state->drewFirstFrame){
-		state->drewFirstFrame = true;
-		SDL_ShowWindow(state->sdl.window);
-	}
-}
+	State_StopRecording(state);
+
+	State_DestroyPendingThemes(state);
+	State_StopCustomTheme(state);
 
-void State_Destroy(State* state){
 	if(state->sdl.renderer) SDL_DestroyRenderer(state->sdl.renderer);
 	if(state->sdl.window) SDL_DestroyWindow(state->sdl.window);
 
@@ -787,5 +1075,13 @@ void State_Destroy(State* state){
 
 	State_DestroyLua(state);
 
-	CoUninitialize();
+	if(state->metrics) Metrics_Free(state->metrics);
+
+	if(state->game.solverCache) SolverCache_Free(state->game.solverCache);
+	if(state->game.solveState){
+		SolveState_Free(state->game.solveState);
+		free(state->game.solveState);
+	}
+
+	if(state->com.init) CoUninitialize();
 }
\ No newline at end of file
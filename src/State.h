@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Win.h"
+#include "Neighborhood.h"
+#include "Random.h"
+#include "Difficulty.h"
+#include "PerfHud.h"
+#include "Histogram.h"
 
 #include <stdbool.h>
 
@@ -26,6 +31,14 @@ typedef struct Tile {
 	uint8_t surroundingMines;
 } Tile;
 
+// inputs whose latency is measured separately
+typedef enum InputKind {
+	INPUT_KIND_BUTTON,
+	INPUT_KIND_MOTION,
+	INPUT_KIND_KEY,
+	INPUT_KIND_COUNT,
+} InputKind;
+
 typedef enum GameMode {
 	GAMEMODE_DEFAULT,
 	GAMEMODE_CUSTOM
@@ -34,12 +47,17 @@ typedef enum GameMode {
 typedef struct State {
 	bool shouldQuit;
 
+	struct {
+		bool init;
+	} com;
+
 	bool gameOver;
 	bool gameWon;
-	uint64_t ticksEnded;
+	// performance counters, like every other time
+	uint64_t counterEnded;
 
 	bool gameStarted;
-	uint64_t ticksStarted;
+	uint64_t counterStarted;
 
 	struct {
 		bool init;
@@ -80,6 +98,11 @@ typedef struct State {
 		} border;
 	} layoutv2;
 
+	// window size the layout was last calculated for
+	struct {
+		int width, height;
+	} layoutSize;
+
 	bool drewFirstFrame;
 
 	struct {
@@ -90,15 +113,52 @@ typedef struct State {
 		int nMines;
 		int tilesLeft;
 		int minesFlagged;
+
+		// scored as soon as the game is created
+		BoardScore score;
+		// how the generator got to this board: mines it moved, and boards it threw away
+		int nGeneratorMoves;
+		int nGeneratorRestarts;
+		// solver iterations and performance counter ticks of band search threads, which
+		// solve with states of their own
+		uint64_t nBandIters;
+		uint64_t bandSolveCounter;
+
+		// bumped every time the board is recreated
+		uint32_t generation;
 	} board;
 
 	struct {
 		GameMode mode;
+		// which tiles numbers count, as the game mode describes it
+		Neighborhood neighborhoodRule;
+		// neighborhoodRule fitted to the board, see Neighborhood_Fit
+		Neighborhood neighborhood;
+
+		// default boards are kept inside this band if it's enabled
+		DifficultyBand band;
+
+		// default boards are generated from this, seeded once per game
+		Random random;
+		uint64_t seed;
+		// shared by every solve on this state's thread
+		struct SolverCache* solverCache;
+		// what generators solve boards with, kept so each board doesn't allocate its own
+		struct SolveState* solveState;
+
+		// set by a replay so the next game gets the recorded seed
+		bool hasPendingSeed;
+		uint64_t pendingSeed;
 		struct {
 			lua_State* state;
 			int createGameRef;
 			int generateMinesRef;
 			int countMinesRef;
+			// the script compiled, create_game runs it in a new lua_State every time
+			char* chunk;
+			size_t chunkSize;
+			// where that lua_State allocates, only when there's a create_game
+			struct LuaArena* arena;
 		} lua;
 	} game;
 
@@ -111,6 +171,16 @@ typedef struct State {
 			} sourceTextures;
 			SDL_Texture* texture;
 
+			// themes not shown on startup are decoded on a background thread
+			// and only turned into textures once they're picked
+			struct {
+				SDL_Thread* thread;
+				SDL_Surface* cute;
+			} pending;
+
+			// decodes the custom theme and hot reloads it when the file changes
+			struct ThemeWatcher* customWatcher;
+
 			SDL_Rect normal;
 			SDL_Rect pressed;
 			SDL_Rect flaged;
@@ -156,28 +226,72 @@ typedef struct State {
 	} mouse;
 
 	HMENU menu;
+
+	// writes handled events to a file, see Replay.h
+	struct Recorder* recorder;
+
+	// where F12 dumps trace spans, NULL if it doesn't, see Trace.h
+	const char* tracePath;
+
+	PerfHud perfHud;
+	// NULL unless metrics are written to a file, see Metrics.h
+	struct Metrics* metrics;
+	// NULL in headless states, see Watchdog.h
+	struct Watchdog* watchdog;
+	// moves of the current game for undo, NULL if they aren't kept, see History.h
+	struct History* history;
+
+	// from an input arriving to the first present after it was handled
+	struct {
+		// inputs handled since the last present: when each arrived and what it was
+		uint64_t pendingArrivals[LATENCY_MAX_PENDING];
+		InputKind pendingKinds[LATENCY_MAX_PENDING];
+		int nPending;
+
+		// in us
+		Histogram histograms[INPUT_KIND_COUNT];
+	} latency;
 } State;
 
 bool State_Init(State*);
+// no window, renderer or resources: enough to run game logic
+bool State_InitHeadless(State*);
 
 void State_CreateMenu(State*);
+void State_CheckCustomTheme(State*, LPCWSTR fileName);
 
 void State_InitBoard(State*);
 void State_InitLayout(State*);
 
 void State_ResetBoard(State*);
+// back to no mines and nothing uncovered, without reallocating
+void State_ClearBoard(State*);
 void State_CreateBoard(State*);
+// takes effect on the current board too
+void State_SetNeighborhood(State*, const Neighborhood* rule);
 
 void State_GenerateMinesDefault(State* state, int tileX, int tileY);
 void State_GenerateFlagsDefault(State* state);
-void State_CreateGameDefault(State*, int tileX, int tileY);
+// returns false if no solvable board came out of GENERATOR_MAX_BOARDS, the board is left cleared
+bool State_CreateGameDefault(State*, int tileX, int tileY);
 
 void State_RecalculateBoardLayout(State*);
 void State_RecalculateLayout(State*, int width, int height);
 
-void State_HandleEvent(State*, SDL_Event*);
+void State_ClickTile(State*, int tileX, int tileY);
+void State_FlagTile(State*, int tileX, int tileY);
+
+// counted as a draw call by the perf HUD
+void State_RenderSprite(State*, const SDL_Rect* src, const SDL_FRect* dst);
+
+// arrived is the performance counter when the event was taken off the queue
+void State_HandleEvent(State*, SDL_Event*, uint64_t arrived);
 void State_HandleMenuEvent(State*, HWND, WORD id);
 void State_Update(State*);
+// the board and its UI, without the perf HUD or presenting
+void State_Draw(State*);
+// input to present latency so far, per InputKind
+void State_PrintLatency(State*);
 
 void State_DestroyBoard(State*);
 
@@ -0,0 +1,153 @@
+#include "State.h"
+#include "Resources.h"
+#include "Constants.h"
+#include "Win.h"
+#include "Watchdog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+// decodes a custom tilesheet off the main thread, then keeps watching the
+// file and decodes it again whenever it changes
+typedef struct ThemeWatcher {
+	SDL_Thread* thread;
+	HANDLE stopEvent;
+
+	wchar_t* path;
+	char* pathMB;
+
+	// latest decoded surface the main thread hasn't picked up yet
+	// swapped with SDL_AtomicSetPtr from both sides
+	SDL_Surface* decoded;
+
+	// the first upload selects the theme, later ones are hot reloads
+	bool uploadedOnce;
+} ThemeWatcher;
+
+static bool GetLastWriteTime(const wchar_t* path, FILETIME* lastWriteTime){
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesExW(path, GetFileExInfoStandard, &attributes)) return false;
+	*lastWriteTime = attributes.ftLastWriteTime;
+	return true;
+}
+
+static void ThemeWatcher_Decode(ThemeWatcher* watcher){
+	SDL_Surface* surface = IMG_Load(watcher->pathMB);
+	if(surface == NULL){
+		fprintf(stderr, "Could not load custom theme \"%s\": %s\n", watcher->pathMB, SDL_GetError());
+		return;
+	}
+
+	// if the main thread never picked up the last one, it's stale now
+	SDL_Surface* stale = SDL_AtomicSetPtr((void**) &watcher->decoded, surface);
+	if(stale != NULL) SDL_FreeSurface(stale);
+}
+
+static int ThemeWatcherThread(void* data){
+	ThemeWatcher* watcher = data;
+
+	FILETIME lastWriteTime = { 0 };
+	GetLastWriteTime(watcher->path, &lastWriteTime);
+
+	ThemeWatcher_Decode(watcher);
+
+	// change notifications are per directory
+	wchar_t* directory = _wcsdup(watcher->path);
+	PathRemoveFileSpecW(directory);
+	HANDLE change = FindFirstChangeNotificationW(
+		directory,
+		FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME
+	);
+	free(directory);
+
+	if(change == INVALID_HANDLE_VALUE){
+		fprintf(stderr, "Could not watch custom theme for changes\n");
+		WaitForSingleObject(watcher->stopEvent, INFINITE);
+		return 0;
+	}
+
+	HANDLE handles[] = { watcher->stopEvent, change };
+	while(WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1){
+		// image editors tend to save in several writes
+		// wait until a whole THEME_WATCHER_SETTLE_MS goes by without a change before decoding it
+		DWORD settled;
+		do{
+			FindNextChangeNotification(change);
+			settled = WaitForMultipleObjects(2, handles, FALSE, THEME_WATCHER_SETTLE_MS);
+		} while(settled == WAIT_OBJECT_0 + 1);
+		if(settled != WAIT_TIMEOUT) break;
+
+		FILETIME writeTime;
+		if(
+			GetLastWriteTime(watcher->path, &writeTime)
+			&& (writeTime.dwLowDateTime != lastWriteTime.dwLowDateTime || writeTime.dwHighDateTime != lastWriteTime.dwHighDateTime)
+		){
+			lastWriteTime = writeTime;
+			ThemeWatcher_Decode(watcher);
+		}
+	}
+
+	FindCloseChangeNotification(change);
+	return 0;
+}
+
+void State_LoadCustomTheme(State* state, const wchar_t* path, const char* pathMB){
+	State_StopCustomTheme(state);
+
+	ThemeWatcher* watcher = calloc(1, sizeof(*watcher));
+	watcher->path = _wcsdup(path);
+	watcher->pathMB = _strdup(pathMB);
+	watcher->stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	watcher->thread = SDL_CreateThread(ThemeWatcherThread, "ThemeWatcher", watcher);
+
+	state->images.tilesheet.customWatcher = watcher;
+}
+
+void State_PollCustomTheme(State* state){
+	ThemeWatcher* watcher = state->images.tilesheet.customWatcher;
+	if(watcher == NULL) return;
+
+	SDL_Surface* surface = SDL_AtomicSetPtr((void**) &watcher->decoded, NULL);
+	if(surface == NULL) return;
+
+	WatchdogPhase phase = Watchdog_SetPhase(state->watchdog, WATCHDOG_PHASE_TEXTURE);
+	SDL_Texture* newTexture = SDL_CreateTextureFromSurface(state->sdl.renderer, surface);
+	SDL_FreeSurface(surface);
+	Watchdog_SetPhase(state->watchdog, phase);
+	if(newTexture == NULL) return;
+
+	SDL_Texture* oldTexture = state->images.tilesheet.sourceTextures.custom;
+	bool selected = !watcher->uploadedOnce || state->images.tilesheet.texture == oldTexture;
+
+	state->images.tilesheet.sourceTextures.custom = newTexture;
+	if(selected){
+		state->images.tilesheet.texture = newTexture;
+		State_UpdateBackgroundColor(state);
+	}
+	if(oldTexture != NULL) SDL_DestroyTexture(oldTexture);
+
+	if(!watcher->uploadedOnce){
+		watcher->uploadedOnce = true;
+		State_CheckCustomTheme(state, PathFindFileNameW(watcher->path));
+	}
+}
+
+void State_StopCustomTheme(State* state){
+	ThemeWatcher* watcher = state->images.tilesheet.customWatcher;
+	if(watcher == NULL) return;
+
+	SetEvent(watcher->stopEvent);
+	SDL_WaitThread(watcher->thread, NULL);
+	CloseHandle(watcher->stopEvent);
+
+	if(watcher->decoded != NULL) SDL_FreeSurface(watcher->decoded);
+	free(watcher->path);
+	free(watcher->pathMB);
+	free(watcher);
+
+	state->images.tilesheet.customWatcher = NULL;
+}
@@ -0,0 +1,270 @@
+#include "Thumbnail.h"
+#include "State.h"
+#include "Snapshot.h"
+#include "Resources.h"
+#include "Sprites.h"
+#include "Constants.h"
+#include "Win.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+typedef struct ThumbnailList {
+	// the list file's contents, split into lines in place
+	char* data;
+	char** paths;
+	int nPaths;
+	// where each one is written, NULL for a path listed again
+	char** outPaths;
+} ThumbnailList;
+
+// a saved game's file name without its extension, the part of the path its thumbnail is named after
+typedef struct ThumbnailName {
+	const char* path;
+	const char* name;
+	int nameLength;
+	int index;
+} ThumbnailName;
+
+typedef struct ThumbnailWorker {
+	SDL_Thread* thread;
+	const ThumbnailList* list;
+	int width, height;
+	SDL_atomic_t* nextPath;
+
+	int nWritten;
+	int nFailed;
+} ThumbnailWorker;
+
+static bool ThumbnailList_Read(ThumbnailList* list, const char* path){
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if(size < 0){
+		fclose(file);
+		return false;
+	}
+
+	list->data = malloc(size + 1);
+	size_t nRead = fread(list->data, 1, size, file);
+	fclose(file);
+	list->data[nRead] = '\0';
+
+	int capacity = 64;
+	list->paths = malloc(capacity * sizeof(*list->paths));
+	list->nPaths = 0;
+
+	char* line = list->data;
+	while(*line != '\0'){
+		char* end = line + strcspn(line, "\r\n");
+		char* next = *end == '\0' ? end : end + 1;
+		*end = '\0';
+
+		if(*line != '\0'){
+			if(list->nPaths == capacity){
+				capacity *= 2;
+				list->paths = realloc(list->paths, capacity * sizeof(*list->paths));
+			}
+			list->paths[list->nPaths++] = line;
+		}
+		line = next;
+	}
+	return true;
+}
+
+static void ThumbnailList_Free(ThumbnailList* list){
+	if(list->outPaths != NULL){
+		for(int i = 0; i < list->nPaths; ++i) free(list->outPaths[i]);
+	}
+	free(list->outPaths);
+	free(list->paths);
+	free(list->data);
+}
+
+static ThumbnailName Thumbnail_GetName(const char* path, int index){
+	const char* name = path;
+	for(const char* c = path; *c != '\0'; ++c){
+		if(*c == '/' || *c == '\\') name = c + 1;
+	}
+	const char* extension = strrchr(name, '.');
+	return (ThumbnailName) {
+		.path = path,
+		.name = name,
+		.nameLength = (int) (extension != NULL ? (size_t) (extension - name) : strlen(name)),
+		.index = index,
+	};
+}
+
+// by name, the way Windows compares file names, then by the whole path
+static int ThumbnailName_Compare(const void* a, const void* b){
+	const ThumbnailName* nameA = a;
+	const ThumbnailName* nameB = b;
+	int compared = _strnicmp(nameA->name, nameB->name, KET_MIN(nameA->nameLength, nameB->nameLength));
+	if(compared == 0) compared = nameA->nameLength - nameB->nameLength;
+	if(compared == 0) compared = strcmp(nameA->path, nameB->path);
+	if(compared == 0) compared = nameA->index - nameB->index;
+	return compared;
+}
+
+// FNV-1a, so a thumbnail keeps its name whatever else is on the list
+static uint32_t Thumbnail_HashPath(const char* path){
+	uint32_t hash = 2166136261u;
+	for(const char* c = path; *c != '\0'; ++c){
+		hash = (hash ^ (uint8_t) *c) * 16777619u;
+	}
+	return hash;
+}
+
+// outDir/<file name without its extension>.png
+// saved games from different folders with the same name get the hash of their path
+// added, outDir/<name>-<hash>.png, instead of writing over each other
+// returns how many paths were listed more than once, those aren't rendered again
+static int ThumbnailList_NameOutputs(ThumbnailList* list, const char* outDir){
+	ThumbnailName* names = malloc(list->nPaths * sizeof(*names));
+	for(int i = 0; i < list->nPaths; ++i) names[i] = Thumbnail_GetName(list->paths[i], i);
+	qsort(names, list->nPaths, sizeof(*names), ThumbnailName_Compare);
+
+	list->outPaths = calloc(list->nPaths, sizeof(*list->outPaths));
+	int nRepeated = 0;
+	for(int start = 0, end; start < list->nPaths; start = end){
+		end = start + 1;
+		while(end < list->nPaths && names[end].nameLength == names[start].nameLength
+			&& _strnicmp(names[end].name, names[start].name, names[start].nameLength) == 0){
+			++end;
+		}
+
+		for(int i = start; i < end; ++i){
+			const ThumbnailName* name = &names[i];
+			if(i > start && strcmp(name->path, names[i - 1].path) == 0){
+				++nRepeated;
+				continue;
+			}
+
+			size_t size = strlen(outDir) + 1 + name->nameLength + sizeof("-00000000.png");
+			char* outPath = malloc(size);
+			if(end - start == 1) snprintf(outPath, size, "%s/%.*s.png", outDir, name->nameLength, name->name);
+			else snprintf(outPath, size, "%s/%.*s-%08x.png", outDir, name->nameLength, name->name, Thumbnail_HashPath(name->path));
+			list->outPaths[name->index] = outPath;
+		}
+	}
+
+	free(names);
+	return nRepeated;
+}
+
+static bool Thumbnail_Render(State* state, SDL_Surface* surface, const char* path, const char* outPath){
+	int wideLength = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+	wchar_t* widePath = malloc(wideLength * sizeof(*widePath));
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, wideLength);
+	bool loaded = State_LoadSnapshot(state, widePath);
+	free(widePath);
+	if(!loaded) return false;
+
+	State_Draw(state);
+	// draws are batched until then
+	SDL_RenderFlush(state->sdl.renderer);
+
+	bool written = IMG_SavePNG(surface, outPath) == 0;
+	if(!written) fprintf(stderr, "Could not write thumbnail \"%s\": %s\n", outPath, SDL_GetError());
+	return written;
+}
+
+static int ThumbnailThread(void* data){
+	ThumbnailWorker* worker = data;
+
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, worker->width, worker->height, 32, SDL_PIXELFORMAT_RGBA32);
+
+	SDL_Renderer* renderer = surface != NULL ? SDL_CreateSoftwareRenderer(surface) : NULL;
+	if(renderer == NULL){
+		fprintf(stderr, "Could not create a software renderer: %s\n", SDL_GetError());
+		if(surface != NULL) SDL_FreeSurface(surface);
+		return 0;
+	}
+
+	State state;
+	State_InitHeadless(&state);
+	state.sdl.renderer = renderer;
+	state.images.tilesheet.sourceTextures.original = State_LoadEmbeddedTexture(&state, &SPRITES.tilesheets.original);
+	state.images.tilesheet.texture = state.images.tilesheet.sourceTextures.original;
+	State_LoadSpriteRects(&state);
+	State_UpdateBackgroundColor(&state);
+	State_RecalculateLayout(&state, worker->width, worker->height);
+
+	int i;
+	while((i = SDL_AtomicAdd(worker->nextPath, 1)) < worker->list->nPaths){
+		const char* outPath = worker->list->outPaths[i];
+		if(outPath == NULL) continue;
+		if(Thumbnail_Render(&state, surface, worker->list->paths[i], outPath)) ++worker->nWritten;
+		else ++worker->nFailed;
+	}
+
+	// frees the renderer and the tilesheet
+	State_Destroy(&state);
+	SDL_FreeSurface(surface);
+	return 0;
+}
+
+bool Thumbnail_Run(const char* listPath, const char* outDir, int nThreads, int width, int height){
+	if(width <= 0 || height <= 0){
+		fprintf(stderr, "Invalid thumbnail size %dx%d\n", width, height);
+		return false;
+	}
+
+	ThumbnailList list;
+	if(!ThumbnailList_Read(&list, listPath)){
+		fprintf(stderr, "Could not read \"%s\"\n", listPath);
+		return false;
+	}
+
+	int nRepeated = ThumbnailList_NameOutputs(&list, outDir);
+
+	IMG_Init(IMG_INIT_PNG);
+
+	SDL_atomic_t nextPath;
+	SDL_AtomicSet(&nextPath, 0);
+
+	ThumbnailWorker* workers = calloc(nThreads, sizeof(*workers));
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	for(int i = 0; i < nThreads; ++i){
+		workers[i] = (ThumbnailWorker) {
+			.list = &list,
+			.width = width,
+			.height = height,
+			.nextPath = &nextPath,
+		};
+		workers[i].thread = SDL_CreateThread(ThumbnailThread, "Thumbnail", &workers[i]);
+	}
+
+	int nWritten = 0, nFailed = 0;
+	for(int i = 0; i < nThreads; ++i){
+		SDL_WaitThread(workers[i].thread, NULL);
+		nWritten += workers[i].nWritten;
+		nFailed += workers[i].nFailed;
+	}
+	double seconds = (SDL_GetPerformanceCounter() - start) / (double) SDL_GetPerformanceFrequency();
+
+	free(workers);
+	ThumbnailList_Free(&list);
+	IMG_Quit();
+
+	printf(
+		"Rendered %d thumbnails of %dx%d on %d threads in %.2f s, %.0f images/s\n",
+		nWritten,
+		width, height,
+		nThreads,
+		seconds,
+		seconds > 0 ? nWritten / seconds : 0.0
+	);
+	if(nFailed > 0) printf("\t%d saved games could not be rendered\n", nFailed);
+	if(nRepeated > 0) printf("\t%d saved games were listed more than once, and rendered once\n", nRepeated);
+
+	return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+
+// renders saved games (see Snapshot.h) to PNGs without a window, drawn exactly like the game draws them
+//
+// listPath has one saved game per line, each is written to outDir under its own file name, with .png
+// saved games with the same name in different folders get a hash of their path added to it
+// every thread has its own headless State, software renderer, surface and copy of the tilesheet,
+// and takes the next saved game off the list until it's empty
+// returns false if the list couldn't be read
+bool Thumbnail_Run(const char* listPath, const char* outDir, int nThreads, int width, int height);
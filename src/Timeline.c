@@ -0,0 +1,45 @@
+#include "Timeline.h"
+#include "Constants.h"
+
+#include <SDL.h>
+
+#include <stdio.h>
+
+typedef struct TimelineMark {
+	const char* label;
+	uint64_t counter;
+} TimelineMark;
+
+static uint64_t timelineStart;
+static TimelineMark timelineMarks[TIMELINE_MAX_MARKS];
+static SDL_atomic_t timelineNextMark;
+
+void Timeline_Start(void){
+	timelineStart = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&timelineNextMark, 0);
+}
+
+void Timeline_Mark(const char* label){
+	uint64_t counter = SDL_GetPerformanceCounter();
+
+	int i = SDL_AtomicAdd(&timelineNextMark, 1);
+	if(i >= TIMELINE_MAX_MARKS) return;
+
+	timelineMarks[i] = (TimelineMark) {
+		.label = label,
+		.counter = counter,
+	};
+}
+
+void Timeline_Print(void){
+	int nMarks = KET_MIN(SDL_AtomicGet(&timelineNextMark), TIMELINE_MAX_MARKS);
+	double frequency = (double) SDL_GetPerformanceFrequency();
+
+	printf("Startup timeline:\n");
+	for(int i = 0; i < nMarks; ++i){
+		TimelineMark* mark = &timelineMarks[i];
+		// another thread is still writing it
+		if(mark->label == NULL) continue;
+		printf("\t%8.2f ms  %s\n", (mark->counter - timelineStart) * 1000.0 / frequency, mark->label);
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// startup timeline: named timestamps relative to Timeline_Start
+// safe to mark from any thread
+
+void Timeline_Start(void);
+void Timeline_Mark(const char* label);
+void Timeline_Print(void);
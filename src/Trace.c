@@ -0,0 +1,195 @@
+#include "Trace.h"
+#include "Constants.h"
+
+#include <SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef KET_TRACE
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct TraceArg {
+	const char* key;
+	int64_t value;
+} TraceArg;
+
+typedef struct TraceSpan {
+	const char* name;
+	unsigned long threadId;
+	uint64_t start, end;
+	int nArgs;
+	TraceArg args[TRACE_MAX_ARGS];
+} TraceSpan;
+
+// only the thread that owns a buffer writes to it
+// buffers are never freed, so spans of threads that are gone can still be dumped
+typedef struct TraceBuffer {
+	struct TraceBuffer* next;
+	// cleared as the owning thread exits, the next new thread takes the buffer over
+	SDL_atomic_t owned;
+	unsigned long threadId;
+
+	// spans ended so far, the last TRACE_RING_SIZE of them are in ring
+	SDL_atomic_t nWritten;
+	TraceSpan ring[TRACE_RING_SIZE];
+
+	// spans begun but not ended yet, innermost last
+	int depth;
+	TraceSpan open[TRACE_MAX_DEPTH];
+} TraceBuffer;
+
+static TraceBuffer* traceBuffers;
+static SDL_SpinLock traceInitLock;
+static SDL_TLSID traceTLS;
+static uint64_t traceStart;
+
+static TRACE_THREAD_LOCAL TraceBuffer* traceBuffer;
+
+static void Trace_ReleaseBuffer(void* data){
+	TraceBuffer* buffer = data;
+	buffer->depth = 0;
+	SDL_AtomicSet(&buffer->owned, 0);
+}
+
+static TraceBuffer* Trace_AcquireBuffer(void){
+	// only needed for its destructor, which tells us when the thread is done with its buffer
+	SDL_AtomicLock(&traceInitLock);
+	if(traceTLS == 0){
+		traceTLS = SDL_TLSCreate();
+		traceStart = SDL_GetPerformanceCounter();
+	}
+	SDL_AtomicUnlock(&traceInitLock);
+
+	// every band search starts new threads, take over a buffer one of the last ones left behind
+	TraceBuffer* buffer = SDL_AtomicGetPtr((void**) &traceBuffers);
+	while(buffer != NULL && !SDL_AtomicCAS(&buffer->owned, 0, 1)){
+		buffer = buffer->next;
+	}
+
+	if(buffer == NULL){
+		buffer = calloc(1, sizeof(*buffer));
+		if(buffer == NULL) return NULL;
+		SDL_AtomicSet(&buffer->owned, 1);
+
+		do buffer->next = SDL_AtomicGetPtr((void**) &traceBuffers);
+		while(!SDL_AtomicCASPtr((void**) &traceBuffers, buffer->next, buffer));
+	}
+
+	buffer->threadId = SDL_ThreadID();
+	SDL_TLSSet(traceTLS, buffer, Trace_ReleaseBuffer);
+	return buffer;
+}
+
+void Trace_Begin(const char* name){
+	TraceBuffer* buffer = traceBuffer;
+	if(buffer == NULL){
+		buffer = traceBuffer = Trace_AcquireBuffer();
+		if(buffer == NULL) return;
+	}
+
+	// too deep to keep, but Trace_End still pops it
+	if(buffer->depth++ >= TRACE_MAX_DEPTH) return;
+
+	TraceSpan* span = &buffer->open[buffer->depth - 1];
+	span->name = name;
+	span->nArgs = 0;
+	span->start = SDL_GetPerformanceCounter();
+}
+
+void Trace_Arg(const char* key, int64_t value){
+	TraceBuffer* buffer = traceBuffer;
+	if(buffer == NULL || buffer->depth == 0 || buffer->depth > TRACE_MAX_DEPTH) return;
+
+	TraceSpan* span = &buffer->open[buffer->depth - 1];
+	if(span->nArgs == TRACE_MAX_ARGS) return;
+	span->args[span->nArgs++] = (TraceArg) {
+		.key = key,
+		.value = value,
+	};
+}
+
+void Trace_End(void){
+	uint64_t end = SDL_GetPerformanceCounter();
+
+	TraceBuffer* buffer = traceBuffer;
+	if(buffer == NULL || buffer->depth == 0) return;
+	if(buffer->depth-- > TRACE_MAX_DEPTH) return;
+
+	TraceSpan* span = &buffer->open[buffer->depth];
+	span->end = end;
+	span->threadId = buffer->threadId;
+
+	unsigned int n = (unsigned int) SDL_AtomicGet(&buffer->nWritten);
+	buffer->ring[n % TRACE_RING_SIZE] = *span;
+	// publishes the span, Trace_Dump never reads past nWritten
+	SDL_AtomicSet(&buffer->nWritten, (int) (n + 1));
+}
+
+static void Trace_WriteSpan(FILE* file, const TraceSpan* span, double frequency, bool first){
+	fprintf(
+		file,
+		"%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+		first ? "" : ",",
+		span->name,
+		span->threadId,
+		(int64_t) (span->start - traceStart) * 1000000.0 / frequency,
+		(span->end - span->start) * 1000000.0 / frequency
+	);
+	for(int i = 0; i < span->nArgs; ++i){
+		fprintf(file, "%s\"%s\":%lld", i == 0 ? "" : ",", span->args[i].key, (long long) span->args[i].value);
+	}
+	fprintf(file, "}}");
+}
+
+bool Trace_Dump(const char* path){
+	FILE* file = fopen(path, "w");
+	if(file == NULL){
+		fprintf(stderr, "Could not write trace to \"%s\"\n", path);
+		return false;
+	}
+
+	double frequency = (double) SDL_GetPerformanceFrequency();
+	TraceSpan* spans = malloc(TRACE_RING_SIZE * sizeof(*spans));
+	size_t nSpans = 0;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for(TraceBuffer* buffer = SDL_AtomicGetPtr((void**) &traceBuffers); buffer != NULL; buffer = buffer->next){
+		unsigned int end = (unsigned int) SDL_AtomicGet(&buffer->nWritten);
+		unsigned int begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+		for(unsigned int i = begin; i != end; ++i){
+			spans[i - begin] = buffer->ring[i % TRACE_RING_SIZE];
+		}
+
+		// the owner kept going while we copied, whatever it wrote over since is torn
+		unsigned int now = (unsigned int) SDL_AtomicGet(&buffer->nWritten);
+		unsigned int valid = now >= TRACE_RING_SIZE ? KET_MAX(begin, now - TRACE_RING_SIZE + 1) : begin;
+
+		for(unsigned int i = valid; i < end; ++i){
+			Trace_WriteSpan(file, &spans[i - begin], frequency, nSpans++ == 0);
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	free(spans);
+	bool written = !ferror(file);
+	fclose(file);
+
+	if(written) printf("Wrote %zu trace spans to %s\n", nSpans, path);
+	else fprintf(stderr, "Could not write trace to \"%s\"\n", path);
+	return written;
+}
+
+#else
+
+bool Trace_Dump(const char* path){
+	fprintf(stderr, "Could not write trace to \"%s\": built without KET_TRACE\n", path);
+	return false;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// spans around hot paths, only recorded in builds with KET_TRACE
+// every thread records into its own ring buffer, so the oldest spans get overwritten
+// Trace_Dump writes them out as Chrome trace events (chrome://tracing or ui.perfetto.dev)
+
+#ifdef KET_TRACE
+#define TRACE_BEGIN(name) Trace_Begin(name)
+#define TRACE_ARG(key, value) Trace_Arg(key, (int64_t) (value))
+#define TRACE_END() Trace_End()
+#else
+#define TRACE_BEGIN(name) ((void) 0)
+#define TRACE_ARG(key, value) ((void) 0)
+#define TRACE_END() ((void) 0)
+#endif
+
+// name and key must outlive the trace, ie: string literals
+void Trace_Begin(const char* name);
+// attaches to the innermost span that hasn't ended yet
+void Trace_Arg(const char* key, int64_t value);
+void Trace_End(void);
+
+// safe to call while other threads keep tracing, their spans in flight are skipped
+// returns false if the file couldn't be written or tracing isn't compiled in
+bool Trace_Dump(const char* path);
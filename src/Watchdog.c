@@ -0,0 +1,164 @@
+#include "Watchdog.h"
+#include "Solver.h"
+#include "Constants.h"
+#include "Win.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <SDL.h>
+
+static const char* WATCHDOG_PHASE_NAMES[WATCHDOG_PHASE_COUNT] = {
+	[WATCHDOG_PHASE_IDLE] = "idle",
+	[WATCHDOG_PHASE_EVENTS] = "events",
+	[WATCHDOG_PHASE_FRAME] = "frame",
+	[WATCHDOG_PHASE_GENERATION] = "generation",
+	[WATCHDOG_PHASE_LUA] = "lua",
+	[WATCHDOG_PHASE_TEXTURE] = "texture",
+};
+
+typedef struct WatchdogBoard {
+	int width, height, nMines;
+	bool custom;
+	uint64_t seed;
+} WatchdogBoard;
+
+struct Watchdog {
+	SDL_Thread* thread;
+	HANDLE stopEvent;
+
+	uint64_t stallCounter;
+	const char* logPath;
+	SolveState* solveState;
+
+	// bumped by the main thread every iteration
+	SDL_atomic_t heartbeats;
+	SDL_atomic_t phase;
+
+	// taken for every copy in or out, so a stall is never logged with half a board
+	SDL_SpinLock boardLock;
+	WatchdogBoard board;
+};
+
+// wraps around, only differences between two reads mean anything
+static uint32_t Watchdog_GetSolverIters(Watchdog* watchdog){
+	return (uint32_t) SDL_AtomicGet(&watchdog->solveState->progress);
+}
+
+static void Watchdog_Log(Watchdog* watchdog, const char* format, ...){
+	FILE* file = stderr;
+	if(watchdog->logPath != NULL){
+		file = fopen(watchdog->logPath, "a");
+		if(file == NULL) file = stderr;
+	}
+
+	char timestamp[32];
+	time_t now = time(NULL);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	fprintf(file, "[%s] ", timestamp);
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(file, format, args);
+	va_end(args);
+
+	if(file == stderr) fflush(file);
+	else fclose(file);
+}
+
+static void Watchdog_LogStall(Watchdog* watchdog, uint64_t ms, uint64_t nIters){
+	SDL_AtomicLock(&watchdog->boardLock);
+	WatchdogBoard board = watchdog->board;
+	SDL_AtomicUnlock(&watchdog->boardLock);
+
+	WatchdogPhase phase = (WatchdogPhase) SDL_AtomicGet(&watchdog->phase);
+	Watchdog_Log(
+		watchdog,
+		"Main loop stalled for %llu ms in %s: board %dx%d:%d (%s), seed 0x%016llx, %llu solver iterations\n",
+		(unsigned long long) ms,
+		WATCHDOG_PHASE_NAMES[phase],
+		board.width, board.height, board.nMines,
+		board.custom ? "custom" : "default",
+		(unsigned long long) board.seed,
+		(unsigned long long) nIters
+	);
+}
+
+static int WatchdogThread(void* data){
+	Watchdog* watchdog = data;
+
+	uint64_t frequency = SDL_GetPerformanceFrequency();
+	int lastHeartbeat = SDL_AtomicGet(&watchdog->heartbeats);
+	uint64_t lastBeat = SDL_GetPerformanceCounter();
+	uint32_t itersAtBeat = Watchdog_GetSolverIters(watchdog);
+	bool stalled = false;
+
+	while(WaitForSingleObject(watchdog->stopEvent, WATCHDOG_POLL_MS) == WAIT_TIMEOUT){
+		uint64_t now = SDL_GetPerformanceCounter();
+		int heartbeat = SDL_AtomicGet(&watchdog->heartbeats);
+
+		if(heartbeat != lastHeartbeat){
+			if(stalled){
+				// the loop came around somewhere between the last poll and this one
+				uint64_t ms = (now - lastBeat) * 1000 / frequency;
+				Watchdog_Log(watchdog, "Main loop recovered after at most %llu ms\n", (unsigned long long) ms);
+				stalled = false;
+			}
+			lastHeartbeat = heartbeat;
+			lastBeat = now;
+			itersAtBeat = Watchdog_GetSolverIters(watchdog);
+			continue;
+		}
+
+		if(!stalled && now - lastBeat >= watchdog->stallCounter){
+			stalled = true;
+			uint64_t ms = (now - lastBeat) * 1000 / frequency;
+			Watchdog_LogStall(watchdog, ms, (uint32_t) (Watchdog_GetSolverIters(watchdog) - itersAtBeat));
+		}
+	}
+
+	return 0;
+}
+
+Watchdog* Watchdog_Start(int stallMs, const char* logPath, SolveState* solveState){
+	Watchdog* watchdog = calloc(1, sizeof(*watchdog));
+	watchdog->stallCounter = (uint64_t) stallMs * SDL_GetPerformanceFrequency() / 1000;
+	watchdog->logPath = logPath;
+	watchdog->solveState = solveState;
+	watchdog->stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	watchdog->thread = SDL_CreateThread(WatchdogThread, "Watchdog", watchdog);
+	return watchdog;
+}
+
+void Watchdog_Stop(Watchdog* watchdog){
+	SetEvent(watchdog->stopEvent);
+	SDL_WaitThread(watchdog->thread, NULL);
+	CloseHandle(watchdog->stopEvent);
+	free(watchdog);
+}
+
+void Watchdog_Heartbeat(Watchdog* watchdog){
+	if(watchdog == NULL) return;
+	SDL_AtomicIncRef(&watchdog->heartbeats);
+}
+
+WatchdogPhase Watchdog_SetPhase(Watchdog* watchdog, WatchdogPhase phase){
+	if(watchdog == NULL) return WATCHDOG_PHASE_IDLE;
+	return (WatchdogPhase) SDL_AtomicSet(&watchdog->phase, (int) phase);
+}
+
+void Watchdog_SetBoard(Watchdog* watchdog, int width, int height, int nMines, bool custom, uint64_t seed){
+	if(watchdog == NULL) return;
+
+	SDL_AtomicLock(&watchdog->boardLock);
+	watchdog->board = (WatchdogBoard) {
+		.width = width,
+		.height = height,
+		.nMines = nMines,
+		.custom = custom,
+		.seed = seed,
+	};
+	SDL_AtomicUnlock(&watchdog->boardLock);
+}
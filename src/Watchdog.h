@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// notices when the main loop stops coming around and logs what it was busy with
+// the main thread publishes what it's doing as it goes, the watchdog only ever reads it
+
+struct SolveState;
+
+typedef enum WatchdogPhase {
+	// between iterations, or anywhere nothing more specific was published
+	WATCHDOG_PHASE_IDLE,
+	// SDL_PollEvent and State_HandleEvent, also where Windows' modal loops
+	// (dragging or resizing the window) hold the main thread
+	WATCHDOG_PHASE_EVENTS,
+	// State_Update
+	WATCHDOG_PHASE_FRAME,
+	// State_CreateGame, the solver's iterations are logged along with it
+	WATCHDOG_PHASE_GENERATION,
+	// create_game of a custom game mode
+	WATCHDOG_PHASE_LUA,
+	// decoding a tilesheet, or uploading it as a texture
+	WATCHDOG_PHASE_TEXTURE,
+	WATCHDOG_PHASE_COUNT,
+} WatchdogPhase;
+
+typedef struct Watchdog Watchdog;
+
+// starts the watchdog's thread, stalls are logged once the loop hasn't come around in stallMs
+// logPath is appended to if it's not NULL, stderr otherwise, it has to outlive the watchdog
+// solveState is the main thread's, only its progress counter is read
+Watchdog* Watchdog_Start(int stallMs, const char* logPath, struct SolveState* solveState);
+void Watchdog_Stop(Watchdog*);
+
+// once per main loop iteration
+void Watchdog_Heartbeat(Watchdog*);
+
+// returns the phase it replaced, set it back once the new one is done
+// all of these do nothing if the watchdog is NULL
+WatchdogPhase Watchdog_SetPhase(Watchdog*, WatchdogPhase);
+
+// the board the main thread is generating or playing, logged with every stall
+void Watchdog_SetBoard(Watchdog*, int width, int height, int nMines, bool custom, uint64_t seed);